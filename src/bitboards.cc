@@ -2,220 +2,213 @@
 
 #include <bit>
 
-// moving masks
-Bitboard KING_MOVE_MASK[64];
-Bitboard KNIGHT_MOVE_MASK[64];
-Bitboard WHITE_PAWN_SINGLE_PUSH_MASK[64];
-Bitboard WHITE_PAWN_CAPTURE_LEFT_MASK[64];
-Bitboard WHITE_PAWN_CAPTURE_RIGHT_MASK[64];
-Bitboard BLACK_PAWN_SINGLE_PUSH_MASK[64];
-Bitboard BLACK_PAWN_CAPTURE_LEFT_MASK[64];
-Bitboard BLACK_PAWN_CAPTURE_RIGHT_MASK[64];
+#if defined(__AVX2__) || defined(HAS_MULTIVERSION)
+#include <immintrin.h>
+#endif
+
+// All tables are built by constexpr functions, so they are embedded as read-only data: nothing has
+// to be initialized at startup and the pages are shared by every running engine process.
+
+using SquarePairTable = std::array<SquareTable, 64>;
+
+static constexpr SquareTable makeKingMoveMask(void) {
+	SquareTable kingMoveMask{};
 
-// masks for pin detection & movement restriction
-Bitboard ROOK_XRAY_MASK[64];
-Bitboard BISHOP_XRAY_MASK[64];
-Bitboard BETWEEN_MASK[64][64];
-Bitboard LINE_MASK[64][64];  // line that goes through 2 points
-
-// blocker masks for magic bitboards
-Bitboard ROOK_BLOCKER_MASK[64];
-Bitboard BISHOP_BLOCKER_MASK[64];
-int ROOK_RELEVANT_BITS[64];
-int BISHOP_RELEVANT_BITS[64];
-
-// attack masks
-Bitboard ROOK_ATTACK_MASK[64][4096];
-Bitboard BISHOP_ATTACK_MASK[64][512];
-
-static void initKingMoveMask(void) {
 	for (int sq = 0; sq < 64; sq++) {
 		Bitboard sqBb = 1ULL << sq;
 
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_H) << 1;
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_A) >> 1;
-		KING_MOVE_MASK[sq] |= (sqBb & ~RANK_8) << 8;
-		KING_MOVE_MASK[sq] |= (sqBb & ~RANK_1) >> 8;
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_H & ~RANK_8) << 9;
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~RANK_8) << 7;
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_H & ~RANK_1) >> 7;
-		KING_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~RANK_1) >> 9;
+		kingMoveMask[sq] |= (sqBb & ~FILE_H) << 1;
+		kingMoveMask[sq] |= (sqBb & ~FILE_A) >> 1;
+		kingMoveMask[sq] |= (sqBb & ~RANK_8) << 8;
+		kingMoveMask[sq] |= (sqBb & ~RANK_1) >> 8;
+		kingMoveMask[sq] |= (sqBb & ~FILE_H & ~RANK_8) << 9;
+		kingMoveMask[sq] |= (sqBb & ~FILE_A & ~RANK_8) << 7;
+		kingMoveMask[sq] |= (sqBb & ~FILE_H & ~RANK_1) >> 7;
+		kingMoveMask[sq] |= (sqBb & ~FILE_A & ~RANK_1) >> 9;
 	}
+	return kingMoveMask;
 }
 
-static void initKnightMoveMask(void) {
+static constexpr SquareTable makeKnightMoveMask(void) {
+	SquareTable knightMoveMask{};
+
 	for (int sq = 0; sq < 64; sq++) {
 		Bitboard sqBb = 1ULL << sq;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_H & ~RANK_8 & ~RANK_7) << 17;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~RANK_8 & ~RANK_7) << 15;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_H & ~RANK_2 & ~RANK_1) >> 15;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~RANK_2 & ~RANK_1) >> 17;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_G & ~FILE_H & ~RANK_8) << 10;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~FILE_B & ~RANK_8) << 6;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_G & ~FILE_H & ~RANK_1) >> 6;
-		KNIGHT_MOVE_MASK[sq] |= (sqBb & ~FILE_A & ~FILE_B & ~RANK_1) >> 10;
+		knightMoveMask[sq] |= (sqBb & ~FILE_H & ~RANK_8 & ~RANK_7) << 17;
+		knightMoveMask[sq] |= (sqBb & ~FILE_A & ~RANK_8 & ~RANK_7) << 15;
+		knightMoveMask[sq] |= (sqBb & ~FILE_H & ~RANK_2 & ~RANK_1) >> 15;
+		knightMoveMask[sq] |= (sqBb & ~FILE_A & ~RANK_2 & ~RANK_1) >> 17;
+		knightMoveMask[sq] |= (sqBb & ~FILE_G & ~FILE_H & ~RANK_8) << 10;
+		knightMoveMask[sq] |= (sqBb & ~FILE_A & ~FILE_B & ~RANK_8) << 6;
+		knightMoveMask[sq] |= (sqBb & ~FILE_G & ~FILE_H & ~RANK_1) >> 6;
+		knightMoveMask[sq] |= (sqBb & ~FILE_A & ~FILE_B & ~RANK_1) >> 10;
 	}
+	return knightMoveMask;
 }
 
-static void initPawnMoveMask(void) {
+// pawn capture masks, Shift is the distance a capture moves the pawn
+template <int Shift, Bitboard ExcludedFile>
+static constexpr SquareTable makePawnCaptureMask(void) {
+	SquareTable captureMask{};
+
 	for (int sq = 0; sq < 64; sq++) {
 		Bitboard sqBb = 1ULL << sq;
-		WHITE_PAWN_SINGLE_PUSH_MASK[sq] = sqBb << 8;
-		WHITE_PAWN_CAPTURE_LEFT_MASK[sq] = (sqBb & ~FILE_A) << 7;
-		WHITE_PAWN_CAPTURE_RIGHT_MASK[sq] = (sqBb & ~FILE_H) << 9;
-		BLACK_PAWN_SINGLE_PUSH_MASK[sq] = sqBb >> 8;
-		BLACK_PAWN_CAPTURE_LEFT_MASK[sq] = (sqBb & ~FILE_A) >> 9;
-		BLACK_PAWN_CAPTURE_RIGHT_MASK[sq] = (sqBb & ~FILE_H) >> 7;
+		if constexpr (Shift > 0) {
+			captureMask[sq] = (sqBb & ~ExcludedFile) << Shift;
+		}
+		else {
+			captureMask[sq] = (sqBb & ~ExcludedFile) >> -Shift;
+		}
 	}
+	return captureMask;
 }
 
-static void initRookBlockerMask(void) {
-	for (int sq = 0; sq < 64; sq++) {
-		int sqRank = sq >> 3;
-		int sqFile = sq & 7;
+static constexpr Bitboard rookBlockerMask(int sq) {
+	int sqRank = sq >> 3;
+	int sqFile = sq & 7;
 
-		Bitboard rookBlockerMask = 0ULL;
+	Bitboard blockerMask = 0ULL;
 
-		for (int rank = sqRank + 1; rank <= 6; rank++) {
-			rookBlockerMask |= 1ULL << (rank * 8 + sqFile);
-		}
-		for (int rank = sqRank - 1; rank >= 1; rank--) {
-			rookBlockerMask |= 1ULL << (rank * 8 + sqFile);
-		}
-		for (int file = sqFile + 1; file <= 6; file++) {
-			rookBlockerMask |= 1ULL << (sqRank * 8 + file);
-		}
-		for (int file = sqFile - 1; file >= 1; file--) {
-			rookBlockerMask |= 1ULL << (sqRank * 8 + file);
-		}
-		ROOK_BLOCKER_MASK[sq] = rookBlockerMask;
-		ROOK_RELEVANT_BITS[sq] = std::popcount(rookBlockerMask);
+	for (int rank = sqRank + 1; rank <= 6; rank++) {
+		blockerMask |= 1ULL << (rank * 8 + sqFile);
+	}
+	for (int rank = sqRank - 1; rank >= 1; rank--) {
+		blockerMask |= 1ULL << (rank * 8 + sqFile);
+	}
+	for (int file = sqFile + 1; file <= 6; file++) {
+		blockerMask |= 1ULL << (sqRank * 8 + file);
+	}
+	for (int file = sqFile - 1; file >= 1; file--) {
+		blockerMask |= 1ULL << (sqRank * 8 + file);
 	}
+	return blockerMask;
 }
 
-static void initBishopBlockerMask(void) {
-	for (int sq = 0; sq < 64; sq++) {
-		int sqRank = sq >> 3;
-		int sqFile = sq & 7;
+static constexpr Bitboard bishopBlockerMask(int sq) {
+	int sqRank = sq >> 3;
+	int sqFile = sq & 7;
 
-		Bitboard bishopBlockerMask = 0ULL;
+	Bitboard blockerMask = 0ULL;
 
-		for (int rank = sqRank - 1, file = sqFile + 1; rank >= 1 && file <= 6; rank--, file++) {
-			bishopBlockerMask |= 1ULL << (rank * 8 + file);
-		}
-		for (int rank = sqRank - 1, file = sqFile - 1; rank >= 1 && file >= 1; rank--, file--) {
-			bishopBlockerMask |= 1ULL << (rank * 8 + file);
-		}
-		for (int rank = sqRank + 1, file = sqFile + 1; rank <= 6 && file <= 6; rank++, file++) {
-			bishopBlockerMask |= 1ULL << (rank * 8 + file);
-		}
-		for (int rank = sqRank + 1, file = sqFile - 1; rank <= 6 && file >= 1; rank++, file--) {
-			bishopBlockerMask |= 1ULL << (rank * 8 + file);
-		}
-		BISHOP_BLOCKER_MASK[sq] = bishopBlockerMask;
-		BISHOP_RELEVANT_BITS[sq] = std::popcount(bishopBlockerMask);
+	for (int rank = sqRank - 1, file = sqFile + 1; rank >= 1 && file <= 6; rank--, file++) {
+		blockerMask |= 1ULL << (rank * 8 + file);
+	}
+	for (int rank = sqRank - 1, file = sqFile - 1; rank >= 1 && file >= 1; rank--, file--) {
+		blockerMask |= 1ULL << (rank * 8 + file);
+	}
+	for (int rank = sqRank + 1, file = sqFile + 1; rank <= 6 && file <= 6; rank++, file++) {
+		blockerMask |= 1ULL << (rank * 8 + file);
+	}
+	for (int rank = sqRank + 1, file = sqFile - 1; rank <= 6 && file >= 1; rank++, file--) {
+		blockerMask |= 1ULL << (rank * 8 + file);
 	}
+	return blockerMask;
 }
 
-static void initRookAttackMask(void) {
-	for (int sq = 0; sq < 64; sq++) {
-		int sqRank = sq >> 3;
-		int sqFile = sq & 7;
+// empty-board rays, [direction][sq]; directions 0-3 move towards higher squares
+constexpr int RAY_D_RANK[8] = {1, 0, 1, 1, -1, 0, -1, -1};
+constexpr int RAY_D_FILE[8] = {0, 1, 1, -1, 0, -1, -1, 1};
 
-		for (Bitboard blockerPattern = ROOK_BLOCKER_MASK[sq];;
-		     blockerPattern = (blockerPattern - 1) & ROOK_BLOCKER_MASK[sq]) {
-			Bitboard rookAttacksBb = 0ULL;
+// plain arrays instead of std::array keep the compile-time evaluation cheap
+struct Rays {
+	Bitboard ray[8][64];
+};
 
-			for (int rank = sqRank + 1; rank <= 7; rank++) {
-				Bitboard sqBb = 1ULL << (rank * 8 + sqFile);
-				rookAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int rank = sqRank - 1; rank >= 0; rank--) {
-				Bitboard sqBb = 1ULL << (rank * 8 + sqFile);
-				rookAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int file = sqFile + 1; file <= 7; file++) {
-				Bitboard sqBb = 1ULL << (sqRank * 8 + file);
-				rookAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int file = sqFile - 1; file >= 0; file--) {
-				Bitboard sqBb = 1ULL << (sqRank * 8 + file);
-				rookAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
+static constexpr Rays makeRays(void) {
+	Rays rays{};
 
-			int idx = static_cast<int>((blockerPattern * ROOK_MAGIC[sq]) >>
-			                           (64 - ROOK_RELEVANT_BITS[sq]));
-			ROOK_ATTACK_MASK[sq][idx] = rookAttacksBb;
-
-			if (!blockerPattern) {
-				break;
+	for (int dir = 0; dir < 8; dir++) {
+		for (int sq = 0; sq < 64; sq++) {
+			for (int rank = (sq >> 3) + RAY_D_RANK[dir], file = (sq & 7) + RAY_D_FILE[dir];
+			     rank >= 0 && rank <= 7 && file >= 0 && file <= 7;
+			     rank += RAY_D_RANK[dir], file += RAY_D_FILE[dir]) {
+				rays.ray[dir][sq] |= 1ULL << (rank * 8 + file);
 			}
 		}
 	}
+	return rays;
 }
 
-static void initBishopAttackMask(void) {
-	for (int sq = 0; sq < 64; sq++) {
-		int sqRank = sq >> 3;
-		int sqFile = sq & 7;
+static constexpr Rays RAYS = makeRays();
 
-		for (Bitboard blockerPattern = BISHOP_BLOCKER_MASK[sq];;
-		     blockerPattern = (blockerPattern - 1) & BISHOP_BLOCKER_MASK[sq]) {
-			Bitboard bishopAttacksBb = 0L;
+// attacks along the given rays, each ray is cut behind its nearest blocker; only used to fill
+// the attack tables
+template <int... Dirs>
+static constexpr Bitboard slidingAttacks(int sq, Bitboard blockers) {
+	Bitboard attacks = 0ULL;
 
-			for (int rank = sqRank - 1, file = sqFile + 1; rank >= 0 && file <= 7; rank--, file++) {
-				Bitboard sqBb = 1ULL << (rank * 8 + file);
-				bishopAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int rank = sqRank - 1, file = sqFile - 1; rank >= 0 && file >= 0; rank--, file--) {
-				Bitboard sqBb = 1ULL << (rank * 8 + file);
-				bishopAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int rank = sqRank + 1, file = sqFile + 1; rank <= 7 && file <= 7; rank++, file++) {
-				Bitboard sqBb = 1ULL << (rank * 8 + file);
-				bishopAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
-			for (int rank = sqRank + 1, file = sqFile - 1; rank <= 7 && file >= 0; rank++, file--) {
-				Bitboard sqBb = 1ULL << (rank * 8 + file);
-				bishopAttacksBb |= sqBb;
-				if (blockerPattern & sqBb) {
-					break;
-				}
-			}
+	auto addRay = [&](int dir) {
+		Bitboard ray = RAYS.ray[dir][sq];
+		if (Bitboard hit = ray & blockers) {
+			int nearestSq = dir < 4 ? std::countr_zero(hit) : 63 - std::countl_zero(hit);
+			ray ^= RAYS.ray[dir][nearestSq];
+		}
+		attacks |= ray;
+	};
+	(addRay(Dirs), ...);
 
-			int idx = static_cast<int>((blockerPattern * BISHOP_MAGIC[sq]) >>
-			                           (64 - BISHOP_RELEVANT_BITS[sq]));
-			BISHOP_ATTACK_MASK[sq][idx] = bishopAttacksBb;
+	return attacks;
+}
 
-			if (!blockerPattern) {
-				break;
-			}
-		}
+constexpr auto rookAttacksSlow = slidingAttacks<0, 1, 4, 5>;
+constexpr auto bishopAttacksSlow = slidingAttacks<2, 3, 6, 7>;
+
+struct SliderAttackTables {
+	Bitboard attacks[2][ROOK_ATTACK_TABLE_SIZE + BISHOP_ATTACK_TABLE_SIZE];  // [backend][idx]
+};
+
+// builds both layouts in one pass: the carry-rippler walk visits the blocker subsets in increasing
+// PEXT index order, so the PEXT index is just a counter
+static constexpr SliderAttackTables makeSliderAttackTables(void) {
+	SliderAttackTables tables{};
+	size_t offset = 0;
+
+	auto fill = [&](Bitboard mask, Bitboard magic, auto attacksSlow, int sq) {
+		const int shift = 64 - std::popcount(mask);
+		size_t pextIdx = 0;
+
+		Bitboard blockerPattern = 0ULL;
+		do {
+			const Bitboard attacks = attacksSlow(sq, blockerPattern);
+			const size_t magicIdx = static_cast<size_t>((blockerPattern * magic) >> shift);
+
+			tables.attacks[SLIDER_MAGIC][offset + magicIdx] = attacks;
+			tables.attacks[SLIDER_PEXT][offset + pextIdx++] = attacks;
+
+			blockerPattern = (blockerPattern - mask) & mask;
+		} while (blockerPattern);
+
+		offset += pextIdx;
+	};
+
+	for (int sq = 0; sq < 64; sq++) {
+		fill(rookBlockerMask(sq), ROOK_MAGIC[sq], rookAttacksSlow, sq);
+	}
+	for (int sq = 0; sq < 64; sq++) {
+		fill(bishopBlockerMask(sq), BISHOP_MAGIC[sq], bishopAttacksSlow, sq);
+	}
+	return tables;
+}
+
+static constexpr std::array<SliderMagic, 64> makeSliderMagics(const Bitboard *attacks,
+                                                              Bitboard (*blockerMask)(int),
+                                                              const Bitboard *magics) {
+	std::array<SliderMagic, 64> sliderMagics{};
+
+	for (int sq = 0; sq < 64; sq++) {
+		SliderMagic &m = sliderMagics[sq];
+		m.attacks = attacks;
+		m.mask = blockerMask(sq);
+		m.magic = magics[sq];
+		m.shift = static_cast<unsigned>(64 - std::popcount(m.mask));
+		attacks += 1ULL << std::popcount(m.mask);
 	}
+	return sliderMagics;
 }
 
-static void initRookXRayMask(void) {
+static constexpr SquareTable makeRookXRayMask(void) {
+	SquareTable xRayMask{};
+
 	for (int sq = 0; sq < 64; sq++) {
 		int sqRank = sq >> 3;
 		int sqFile = sq & 7;
@@ -235,32 +228,36 @@ static void initRookXRayMask(void) {
 			xRays |= 1ULL << (sqRank * 8 + file);
 		}
 
-		ROOK_XRAY_MASK[sq] = xRays;
+		xRayMask[sq] = xRays;
 	}
+	return xRayMask;
 }
 
-static void initBishopXRayMask(void) {
+static constexpr SquareTable makeBishopXRayMask(void) {
+	SquareTable xRayMask{};
+
 	for (int sq = 0; sq < 64; sq++) {
 		int sqRank = sq >> 3;
 		int sqFile = sq & 7;
 
-		Bitboard xRays = 0L;
+		Bitboard xRays = 0ULL;
 
 		for (int rank = sqRank - 1, file = sqFile + 1; rank >= 0 && file <= 7; rank--, file++) {
-			xRays |= 1L << (rank * 8 + file);
+			xRays |= 1ULL << (rank * 8 + file);
 		}
 		for (int rank = sqRank - 1, file = sqFile - 1; rank >= 0 && file >= 0; rank--, file--) {
-			xRays |= 1L << (rank * 8 + file);
+			xRays |= 1ULL << (rank * 8 + file);
 		}
 		for (int rank = sqRank + 1, file = sqFile + 1; rank <= 7 && file <= 7; rank++, file++) {
-			xRays |= 1L << (rank * 8 + file);
+			xRays |= 1ULL << (rank * 8 + file);
 		}
 		for (int rank = sqRank + 1, file = sqFile - 1; rank <= 7 && file >= 0; rank++, file--) {
-			xRays |= 1L << (rank * 8 + file);
+			xRays |= 1ULL << (rank * 8 + file);
 		}
 
-		BISHOP_XRAY_MASK[sq] = xRays;
+		xRayMask[sq] = xRays;
 	}
+	return xRayMask;
 }
 
 static constexpr int signum(long long x) noexcept {
@@ -269,13 +266,19 @@ static constexpr int signum(long long x) noexcept {
 	return 0;
 }
 
-static void initBetweenMask(void) {
+// masks for pin detection & movement restriction
+constexpr SquareTable ROOK_XRAY_MASK = makeRookXRayMask();
+constexpr SquareTable BISHOP_XRAY_MASK = makeBishopXRayMask();
+
+static constexpr SquarePairTable makeBetweenMask(void) {
+	SquarePairTable betweenMasks{};
+
 	for (int fromSq = 0; fromSq < 64; fromSq++) {
 		int fromSqRank = fromSq >> 3;
 		int fromSqFile = fromSq & 7;
 
 		for (int toSq = 0; toSq < 64; toSq++) {
-			Bitboard toSqBb = 1L << toSq;
+			Bitboard toSqBb = 1ULL << toSq;
 			int toSqRank = toSq >> 3;
 			int toSqFile = toSq & 7;
 
@@ -294,22 +297,25 @@ static void initBetweenMask(void) {
 					break;
 				}
 
-				Bitboard sqBb = 1L << (rank * 8 + file);
+				Bitboard sqBb = 1ULL << (rank * 8 + file);
 				betweenMask |= sqBb;
 			}
 
-			BETWEEN_MASK[fromSq][toSq] = betweenMask;
+			betweenMasks[fromSq][toSq] = betweenMask;
 		}
 	}
+	return betweenMasks;
 }
 
-static void initLineMask(void) {
+static constexpr SquarePairTable makeLineMask(void) {
+	SquarePairTable lineMasks{};
+
 	for (int sq1 = 0; sq1 < 64; sq1++) {
 		int sq1Rank = sq1 >> 3;
 		int sq1File = sq1 & 7;
 
 		for (int sq2 = 0; sq2 < 64; sq2++) {
-			Bitboard sq2BB = 1L << sq2;
+			Bitboard sq2BB = 1ULL << sq2;
 			int sq2Rank = sq2 >> 3;
 			int sq2File = sq2 & 7;
 
@@ -320,35 +326,190 @@ static void initLineMask(void) {
 			int dRank = signum(sq2Rank - sq1Rank);
 			int dFile = signum(sq2File - sq1File);
 
-			Bitboard ray = 0L;
+			Bitboard ray = 0ULL;
 
 			for (int rank = sq1Rank, file = sq1File;
 			     rank >= 0 && rank <= 7 && file >= 0 && file <= 7; rank += dRank, file += dFile) {
-				Bitboard sqBB = 1L << (rank * 8 + file);
+				Bitboard sqBB = 1ULL << (rank * 8 + file);
 				ray |= sqBB;
 			}
 
 			for (int rank = sq1Rank, file = sq1File;
 			     rank >= 0 && rank <= 7 && file >= 0 && file <= 7; rank -= dRank, file -= dFile) {
-				Bitboard sqBB = 1L << (rank * 8 + file);
+				Bitboard sqBB = 1ULL << (rank * 8 + file);
 				ray |= sqBB;
 			}
 
-			LINE_MASK[sq1][sq2] = ray;
+			lineMasks[sq1][sq2] = ray;
 		}
 	}
+	return lineMasks;
+}
+
+// moving masks
+constexpr SquareTable KING_MOVE_MASK = makeKingMoveMask();
+constexpr SquareTable KNIGHT_MOVE_MASK = makeKnightMoveMask();
+constexpr SquareTable WHITE_PAWN_CAPTURE_LEFT_MASK = makePawnCaptureMask<7, FILE_A>();
+constexpr SquareTable WHITE_PAWN_CAPTURE_RIGHT_MASK = makePawnCaptureMask<9, FILE_H>();
+constexpr SquareTable BLACK_PAWN_CAPTURE_LEFT_MASK = makePawnCaptureMask<-9, FILE_A>();
+constexpr SquareTable BLACK_PAWN_CAPTURE_RIGHT_MASK = makePawnCaptureMask<-7, FILE_H>();
+
+constexpr SquarePairTable BETWEEN_MASK = makeBetweenMask();
+constexpr SquarePairTable LINE_MASK = makeLineMask();  // line that goes through 2 points
+
+// fancy magic attack tables, one layout per backend
+alignas(64) static constexpr SliderAttackTables SLIDER_ATTACK_TABLE = makeSliderAttackTables();
+
+constexpr std::array<std::array<SliderMagic, 64>, 2> ROOK_MAGICS = {
+    makeSliderMagics(SLIDER_ATTACK_TABLE.attacks[SLIDER_MAGIC], rookBlockerMask, ROOK_MAGIC),
+    makeSliderMagics(SLIDER_ATTACK_TABLE.attacks[SLIDER_PEXT], rookBlockerMask, ROOK_MAGIC),
+};
+constexpr std::array<std::array<SliderMagic, 64>, 2> BISHOP_MAGICS = {
+    makeSliderMagics(SLIDER_ATTACK_TABLE.attacks[SLIDER_MAGIC] + ROOK_ATTACK_TABLE_SIZE,
+                     bishopBlockerMask, BISHOP_MAGIC),
+    makeSliderMagics(SLIDER_ATTACK_TABLE.attacks[SLIDER_PEXT] + ROOK_ATTACK_TABLE_SIZE,
+                     bishopBlockerMask, BISHOP_MAGIC),
+};
+
+SliderBackend sliderBackend = SLIDER_MAGIC;
+
+bool isPextSupported(void) {
+	// the PEXT lookups are always compiled where the ISA has them, only the CPU has to support it
+#if defined(HAS_PEXT) && (defined(__GNUC__) || defined(__clang__))
+	return __builtin_cpu_supports("bmi2");
+#elif defined(HAS_PEXT)
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7) return false;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] >> 8) & 1;  // ebx bit 8
+#else
+	return false;
+#endif
+}
+
+void setSliderBackend(SliderBackend backend) {
+	sliderBackend = backend == SLIDER_PEXT && isPextSupported() ? SLIDER_PEXT : SLIDER_MAGIC;
+}
+
+const char *cpuIsaLevel(void) {
+	// the same cpuid checks the multiversioned kernels are dispatched with
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+	if (__builtin_cpu_supports("x86-64-v4")) return "x86-64-v4";
+	if (__builtin_cpu_supports("x86-64-v3")) return "x86-64-v3";
+	if (__builtin_cpu_supports("x86-64-v2")) return "x86-64-v2";
+	return "x86-64";
+#else
+	return "unknown";
+#endif
+}
+
+// native builds only compile the kernel for their own ISA, multiversioned builds compile all of them
+// & let the loader pick one
+#if defined(HAS_MULTIVERSION)
+#define SLIDER_MAP_AVX512 __attribute__((target("arch=x86-64-v4")))
+#define SLIDER_MAP_AVX2 __attribute__((target("arch=x86-64-v3")))
+#define SLIDER_MAP_SCALAR __attribute__((target("default")))
+#elif defined(__AVX512F__)
+#define SLIDER_MAP_AVX512
+#elif defined(__AVX2__)
+#define SLIDER_MAP_AVX2
+#else
+#define SLIDER_MAP_SCALAR
+#endif
+
+#if defined(SLIDER_MAP_AVX512)
+// shift each lane left or right by its own count, lambdas would not inherit the target attribute
+SLIDER_MAP_AVX512 static inline __m512i shiftLanes(__m512i x, __m512i l, __m512i r) {
+	return _mm512_or_si512(_mm512_sllv_epi64(x, l), _mm512_srlv_epi64(x, r));
+}
+
+SLIDER_MAP_AVX512 Bitboard sliderAttackMap(Bitboard rooksQueens, Bitboard bishopsQueens,
+                                           Bitboard occ) {
+	// Kogge-Stone occluded fill of all eight directions at once, one direction per lane:
+	// N, S, E, W for rooks & queens, NE, NW, SE, SW for bishops & queens. A lane shifts left or right,
+	// the unused shift gets a count of 64 which yields zero
+	const __m512i left = _mm512_set_epi64(64, 64, 7, 9, 64, 1, 64, 8);
+	const __m512i right = _mm512_set_epi64(9, 7, 64, 64, 1, 64, 8, 64);
+	const __m512i wrap = _mm512_set_epi64(~FILE_H, ~FILE_A, ~FILE_H, ~FILE_A, ~FILE_H, ~FILE_A,
+	                                      ~0ULL, ~0ULL);
+	__m512i gen = _mm512_set_epi64(bishopsQueens, bishopsQueens, bishopsQueens, bishopsQueens,
+	                               rooksQueens, rooksQueens, rooksQueens, rooksQueens);
+	__m512i pro = _mm512_and_si512(_mm512_set1_epi64(~occ), wrap);
+
+	__m512i l = left, r = right;
+	for (int step = 0; step < 3; step++) {
+		gen = _mm512_or_si512(gen, _mm512_and_si512(pro, shiftLanes(gen, l, r)));
+		pro = _mm512_and_si512(pro, shiftLanes(pro, l, r));
+		l = _mm512_add_epi64(l, l);
+		r = _mm512_add_epi64(r, r);
+	}
+
+	return _mm512_reduce_or_epi64(_mm512_and_si512(shiftLanes(gen, left, right), wrap));
+}
+#endif
+
+#if defined(SLIDER_MAP_AVX2)
+SLIDER_MAP_AVX2 static inline __m256i shiftLanes(__m256i x, __m256i l, __m256i r) {
+	return _mm256_or_si256(_mm256_sllv_epi64(x, l), _mm256_srlv_epi64(x, r));
+}
+
+SLIDER_MAP_AVX2 Bitboard sliderAttackMap(Bitboard rooksQueens, Bitboard bishopsQueens,
+                                         Bitboard occ) {
+	// Kogge-Stone occluded fill, one direction per lane: N, S, E, W in the rook vector and
+	// NE, NW, SE, SW in the bishop vector. A lane shifts left or right, the unused shift gets a
+	// count of 64 which yields zero
+	const __m256i rookLeft = _mm256_set_epi64x(64, 1, 64, 8);
+	const __m256i rookRight = _mm256_set_epi64x(1, 64, 8, 64);
+	const __m256i rookWrap = _mm256_set_epi64x(~FILE_H, ~FILE_A, ~0ULL, ~0ULL);
+	const __m256i bishopLeft = _mm256_set_epi64x(64, 64, 7, 9);
+	const __m256i bishopRight = _mm256_set_epi64x(9, 7, 64, 64);
+	const __m256i bishopWrap = _mm256_set_epi64x(~FILE_H, ~FILE_A, ~FILE_H, ~FILE_A);
+	const __m256i empty = _mm256_set1_epi64x(static_cast<long long>(~occ));
+	__m256i rookGen = _mm256_set1_epi64x(static_cast<long long>(rooksQueens));
+	__m256i bishopGen = _mm256_set1_epi64x(static_cast<long long>(bishopsQueens));
+	__m256i rookPro = _mm256_and_si256(empty, rookWrap);
+	__m256i bishopPro = _mm256_and_si256(empty, bishopWrap);
+
+	__m256i rl = rookLeft, rr = rookRight, bl = bishopLeft, br = bishopRight;
+	for (int step = 0; step < 3; step++) {
+		rookGen = _mm256_or_si256(rookGen, _mm256_and_si256(rookPro, shiftLanes(rookGen, rl, rr)));
+		bishopGen =
+		    _mm256_or_si256(bishopGen, _mm256_and_si256(bishopPro, shiftLanes(bishopGen, bl, br)));
+		rookPro = _mm256_and_si256(rookPro, shiftLanes(rookPro, rl, rr));
+		bishopPro = _mm256_and_si256(bishopPro, shiftLanes(bishopPro, bl, br));
+		rl = _mm256_add_epi64(rl, rl);
+		rr = _mm256_add_epi64(rr, rr);
+		bl = _mm256_add_epi64(bl, bl);
+		br = _mm256_add_epi64(br, br);
+	}
+
+	__m256i attacks =
+	    _mm256_or_si256(_mm256_and_si256(shiftLanes(rookGen, rookLeft, rookRight), rookWrap),
+	                    _mm256_and_si256(shiftLanes(bishopGen, bishopLeft, bishopRight), bishopWrap));
+	__m128i half = _mm_or_si128(_mm256_castsi256_si128(attacks), _mm256_extracti128_si256(attacks, 1));
+	return static_cast<Bitboard>(_mm_cvtsi128_si64(half) | _mm_extract_epi64(half, 1));
+}
+#endif
+
+#if defined(SLIDER_MAP_SCALAR)
+SLIDER_MAP_SCALAR Bitboard sliderAttackMap(Bitboard rooksQueens, Bitboard bishopsQueens,
+                                           Bitboard occ) {
+	// only CPUs without AVX2 run this, magics need no BMI2 either
+	Bitboard attacks = 0ULL;
+
+	while (rooksQueens) {
+		attacks |= getRookAttacks<SLIDER_MAGIC>(std::countr_zero(rooksQueens), occ);
+		rooksQueens &= rooksQueens - 1;
+	}
+	while (bishopsQueens) {
+		attacks |= getBishopAttacks<SLIDER_MAGIC>(std::countr_zero(bishopsQueens), occ);
+		bishopsQueens &= bishopsQueens - 1;
+	}
+	return attacks;
 }
+#endif
 
-void initBitboards(void) {
-	initKingMoveMask();
-	initKnightMoveMask();
-	initPawnMoveMask();
-	initRookBlockerMask();
-	initBishopBlockerMask();
-	initRookAttackMask();
-	initBishopAttackMask();
-	initRookXRayMask();
-	initBishopXRayMask();
-	initBetweenMask();
-	initLineMask();
+Bitboard getSliderAttackMap(Bitboard rooksQueens, Bitboard bishopsQueens, Bitboard occ) {
+	return sliderAttackMap(rooksQueens, bishopsQueens, occ);
 }
@@ -1,6 +1,23 @@
 #ifndef BITBOARDS_HPP
 #define BITBOARDS_HPP
 
+// the PEXT lookups are compiled for BMI2 on their own, so a build for older CPUs still has them &
+// only runs them once isPextSupported() found BMI2 on the running CPU
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAS_PEXT
+#define TARGET_BMI2 __attribute__((target("bmi2")))
+#elif defined(_M_X64)
+#define HAS_PEXT
+#define TARGET_BMI2
+#endif
+
+#if defined(HAS_PEXT)
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <cstddef>
+
 #include "misc.hpp"
 
 // bitboard constants
@@ -18,31 +35,21 @@ constexpr Bitboard FILE_B = 0x0202020202020202ULL;
 constexpr Bitboard FILE_G = 0x4040404040404040ULL;
 constexpr Bitboard FILE_H = 0x8080808080808080ULL;
 
+using SquareTable = std::array<Bitboard, 64>;
+
 // moving masks
-extern Bitboard KING_MOVE_MASK[64];
-extern Bitboard KNIGHT_MOVE_MASK[64];
-extern Bitboard WHITE_PAWN_SINGLE_PUSH_MASK[64];
-extern Bitboard WHITE_PAWN_CAPTURE_LEFT_MASK[64];
-extern Bitboard WHITE_PAWN_CAPTURE_RIGHT_MASK[64];
-extern Bitboard BLACK_PAWN_SINGLE_PUSH_MASK[64];
-extern Bitboard BLACK_PAWN_CAPTURE_LEFT_MASK[64];
-extern Bitboard BLACK_PAWN_CAPTURE_RIGHT_MASK[64];
+extern const SquareTable KING_MOVE_MASK;
+extern const SquareTable KNIGHT_MOVE_MASK;
+extern const SquareTable WHITE_PAWN_CAPTURE_LEFT_MASK;
+extern const SquareTable WHITE_PAWN_CAPTURE_RIGHT_MASK;
+extern const SquareTable BLACK_PAWN_CAPTURE_LEFT_MASK;
+extern const SquareTable BLACK_PAWN_CAPTURE_RIGHT_MASK;
 
 // masks for pin detection & movement restriction
-extern Bitboard ROOK_XRAY_MASK[64];
-extern Bitboard BISHOP_XRAY_MASK[64];
-extern Bitboard BETWEEN_MASK[64][64];
-extern Bitboard LINE_MASK[64][64];  // line that goes through 2 points
-
-// blocker masks for magic bitboards
-extern Bitboard ROOK_BLOCKER_MASK[64];
-extern Bitboard BISHOP_BLOCKER_MASK[64];
-extern int ROOK_RELEVANT_BITS[64];
-extern int BISHOP_RELEVANT_BITS[64];
-
-// attack masks
-extern Bitboard ROOK_ATTACK_MASK[64][4096];
-extern Bitboard BISHOP_ATTACK_MASK[64][512];
+extern const SquareTable ROOK_XRAY_MASK;
+extern const SquareTable BISHOP_XRAY_MASK;
+extern const std::array<SquareTable, 64> BETWEEN_MASK;
+extern const std::array<SquareTable, 64> LINE_MASK;  // line that goes through 2 points
 
 // magic numbers
 constexpr Bitboard ROOK_MAGIC[64] = {
@@ -83,6 +90,65 @@ constexpr Bitboard BISHOP_MAGIC[64] = {
     0x1000042304105ULL,    0x10008830412a00ULL,   0x2520081090008908ULL, 0x40102000a0a60140ULL,
 };
 
-void initBitboards(void);
+// indexing scheme of the slider attack tables, picked once at startup
+enum SliderBackend : uint8_t { SLIDER_MAGIC, SLIDER_PEXT };
+extern SliderBackend sliderBackend;  // only read where the move generator dispatches
+
+// fancy magic entry for one square, aligned so a lookup touches a single cache line
+struct alignas(32) SliderMagic {
+	const Bitboard *attacks;  // this square's slice of the attack table
+	Bitboard mask;            // relevant blockers (board edges excluded)
+	Bitboard magic;
+	unsigned shift;  // 64 - number of relevant blockers
+
+	inline size_t magicIndex(Bitboard occ) const {
+		return static_cast<size_t>(((occ & mask) * magic) >> shift);
+	}
+};
+
+// attack tables: every square only gets 2^(relevant blockers) entries, packed back to back
+constexpr size_t ROOK_ATTACK_TABLE_SIZE = 102400;
+constexpr size_t BISHOP_ATTACK_TABLE_SIZE = 5248;
+extern const std::array<std::array<SliderMagic, 64>, 2> ROOK_MAGICS;    // [backend][sq]
+extern const std::array<std::array<SliderMagic, 64>, 2> BISHOP_MAGICS;  // [backend][sq]
+
+bool isPextSupported(void);
+void setSliderBackend(SliderBackend backend);  // falls back to magics without PEXT support
+const char *cpuIsaLevel(void);                 // best x86-64 ISA level of the running CPU
+
+// union of the attacks of all given sliders, vectorized where AVX2 / AVX-512 is available
+Bitboard getSliderAttackMap(Bitboard rooksQueens, Bitboard bishopsQueens, Bitboard occ);
+
+// the backend is a template parameter, callers are instantiated per backend & dispatched once
+template <SliderBackend Backend>
+Bitboard getRookAttacks(int sq, Bitboard occ);
+template <SliderBackend Backend>
+Bitboard getBishopAttacks(int sq, Bitboard occ);
+
+template <>
+inline Bitboard getRookAttacks<SLIDER_MAGIC>(int sq, Bitboard occ) {
+	const SliderMagic &m = ROOK_MAGICS[SLIDER_MAGIC][sq];
+	return m.attacks[m.magicIndex(occ)];
+}
+
+template <>
+inline Bitboard getBishopAttacks<SLIDER_MAGIC>(int sq, Bitboard occ) {
+	const SliderMagic &m = BISHOP_MAGICS[SLIDER_MAGIC][sq];
+	return m.attacks[m.magicIndex(occ)];
+}
+
+#if defined(HAS_PEXT)
+template <>
+TARGET_BMI2 inline Bitboard getRookAttacks<SLIDER_PEXT>(int sq, Bitboard occ) {
+	const SliderMagic &m = ROOK_MAGICS[SLIDER_PEXT][sq];
+	return m.attacks[_pext_u64(occ, m.mask)];
+}
+
+template <>
+TARGET_BMI2 inline Bitboard getBishopAttacks<SLIDER_PEXT>(int sq, Bitboard occ) {
+	const SliderMagic &m = BISHOP_MAGICS[SLIDER_PEXT][sq];
+	return m.attacks[_pext_u64(occ, m.mask)];
+}
+#endif
 
 #endif  // BITBOARDS_HPP
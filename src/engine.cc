@@ -64,14 +64,8 @@ static Score scoreFromTT(Score score, int ply) {
 	return score;
 }
 
-static int pieceTypeOn(const Position &pos, Bitboard sq, int color) {
-	for (int pt = 0; pt < 6; pt++) {
-		if (pos.pieces[color * 6 + pt] & sq) return pt;
-	}
-	return PT_NULL;
-}
-
-static void scoreMoves(const MoveList &moves, int scores[], const Position &pos, Move ttMove) {
+static void scoreMoves(const Move moves[], size_t moveCount, int scores[], const Position &pos,
+                       Move ttMove) {
 	// MVV-LVA[victim][attacker]
 	static constexpr int MVV_LVA[6][6] = {
 	    /* victim P */ {0, -220, -230, -400, -800, -19900},
@@ -84,7 +78,7 @@ static void scoreMoves(const MoveList &moves, int scores[], const Position &pos,
 	static constexpr int TT_MOVE_SCORE = 10'000'000;
 	static constexpr int CAPTURE_BASE = 1'000'000;
 
-	for (size_t i = 0; i < moves.size(); i++) {
+	for (size_t i = 0; i < moveCount; i++) {
 		const Move &m = moves[i];
 
 		if (m == ttMove) {
@@ -92,10 +86,10 @@ static void scoreMoves(const MoveList &moves, int scores[], const Position &pos,
 			continue;
 		}
 
-		int victim = m.getIsEp() ? PT_PAWN : pieceTypeOn(pos, m.getTo(), pos.oppColor);
+		int victim = m.getIsEp() ? PT_PAWN : pos.pieceTypeOn(m.getToSq(), pos.oppColor);
 
 		if (victim != PT_NULL) {
-			scores[i] = CAPTURE_BASE + MVV_LVA[victim][m.getMovingPt()];
+			scores[i] = CAPTURE_BASE + MVV_LVA[victim][pos.pieceTypeOn(m.getFromSq(), pos.usColor)];
 		}
 		else {
 			scores[i] = 0;
@@ -104,9 +98,9 @@ static void scoreMoves(const MoveList &moves, int scores[], const Position &pos,
 }
 
 // Partial selection sort: swap the highest-scored remaining move into position i
-static void pickNext(MoveList &moves, int scores[], size_t i) {
+static void pickNext(Move moves[], size_t moveCount, int scores[], size_t i) {
 	size_t best = i;
-	for (size_t j = i + 1; j < moves.size(); j++) {
+	for (size_t j = i + 1; j < moveCount; j++) {
 		if (scores[j] > scores[best]) {
 			best = j;
 		}
@@ -121,6 +115,32 @@ static void pickNext(MoveList &moves, int scores[], size_t i) {
 	}
 }
 
+#if defined(KNIGHTRIDER_COPY_MAKE)
+constexpr bool COPY_MAKE = true;
+#else
+constexpr bool COPY_MAKE = false;
+#endif
+
+void Engine::makeSearchMove(Move move) {
+	if constexpr (COPY_MAKE) {
+		searchStack[searchPos.ply].boardBefore = searchPos;
+		searchPos.makeMoveWithoutUndo(move);
+	}
+	else {
+		searchPos.makeMove(move);
+	}
+}
+
+void Engine::undoSearchMove(void) {
+	if constexpr (COPY_MAKE) {
+		// the board is restored from the copy instead of reversing the move
+		searchPos.undoMove(searchStack[searchPos.ply - 1].boardBefore);
+	}
+	else {
+		searchPos.undoMove();
+	}
+}
+
 void Engine::startSearch(const Position &pos, TranspositionTable *tt, const GoLimits &limits,
                          std::chrono::time_point<std::chrono::steady_clock> commandReceiveTime) {
 	// join any previous search thread before starting a new one
@@ -129,12 +149,12 @@ void Engine::startSearch(const Position &pos, TranspositionTable *tt, const GoLi
 	}
 
 	bestMove = Move();  // set bestMove to NULL
-	searchPos = pos;
+	searchPos = pos;  // only copies the board, the stacks are per search thread
+	searchPos.moveHistoryTo(&searchHistory);
 	searchTt = tt;
 	nodesSearched = 0;
 	maxNodes = limits.nodeLimit == -1 ? UINT64_MAX : static_cast<uint64_t>(limits.nodeLimit);
 
-	searchPos.resetPly();   // make sure we start at 0 ply no matter what
 	searchTt->newSearch();  // trigger a new search
 
 	const int64_t budget = computeTimeBudget(limits, pos.usColor);
@@ -160,18 +180,26 @@ Move Engine::fetchBestMove() {
 }
 
 void Engine::rootNegamax(const GoLimits &limits) {
-	MoveList legalMoves =
-	    limits.searchMoves.size() > 0 ? limits.searchMoves : gen.generateLegalMoves();
+	SearchStackEntry &ss = searchStack[0];
+	Move *legalMoves = ss.moves;
+
+	if (limits.searchMoves.size() > 0) {
+		ss.moveCount = limits.searchMoves.size();
+		std::copy(limits.searchMoves.begin(), limits.searchMoves.end(), legalMoves);
+	}
+	else {
+		ss.moveCount = gen.generateLegalMoves(ss.moves, ss.inCheck);
+	}
 
 	// no legal moves
-	if (legalMoves.size() == 0) {
+	if (ss.moveCount == 0) {
 		return;
 	}
 
 	// put tt entry in the front (if exists)
 	TTEntry entry;
 	if (searchTt->probe(searchPos.hash, entry) && !entry.bestMove.isNull()) {
-		for (size_t i = 0; i < legalMoves.size(); i++) {
+		for (size_t i = 0; i < ss.moveCount; i++) {
 			if (legalMoves[i] == entry.bestMove) {
 				if (i != 0) {
 					Move tmp = legalMoves[0];
@@ -193,16 +221,18 @@ void Engine::rootNegamax(const GoLimits &limits) {
 		Move bestMoveFound;
 
 		std::vector<std::pair<Move, Score>> childScores;
-		childScores.reserve(legalMoves.size());
+		childScores.reserve(ss.moveCount);
 
 		Score alpha = -INF;
 		bool aborted = false;
 
-		for (const Move &move : legalMoves) {
-			searchPos.makeMove(move);
+		for (size_t i = 0; i < ss.moveCount; i++) {
+			const Move move = legalMoves[i];
+			searchTt->prefetch(searchPos.keyAfter(move));
+			makeSearchMove(move);
 			bool childAborted = false;
 			Score childScore = -negamax(depth - 1, -INF, -alpha, childAborted);
-			searchPos.undoMove();
+			undoSearchMove();
 
 			if (childAborted || searchStopRequested) {
 				aborted = true;
@@ -232,6 +262,8 @@ void Engine::rootNegamax(const GoLimits &limits) {
 		const Score storedScore = scoreToTT(bestChildScore, searchPos.ply);
 		searchTt->store(searchPos.hash, depth, storedScore, TT_EXACT, bestMoveFound);
 
+		printSafe("info depth ", depth, " nodes ", nodesSearched, " hashfull ", searchTt->hashfull());
+
 		// simple move ordering
 		std::stable_sort(childScores.begin(), childScores.end(),
 		                 [](auto &a, auto &b) { return a.second > b.second; });
@@ -279,24 +311,27 @@ Score Engine::negamax(int depth, Score alpha, Score beta, bool &searchCancelledO
 		}
 	}
 
-	if (searchPos.is50MoveDraw() || searchPos.isInsufficientMaterial() ||
+	if (searchPos.is50MoveDraw() || materialTable.probe(searchPos).isInsufficient(searchPos) ||
 	    searchPos.isRepetition()) {
 		return 0;
 	}
 
-	// quick bailout for checkmates and draws
-	MoveList legalMoves = gen.generateLegalMoves();
-	if (legalMoves.size() == 0) {
-		Score terminalScore = legalMoves.inCheck() ? MATED_SCORE + ply : 0;
-		const Score storedScore = scoreToTT(terminalScore, ply);
-		searchTt->store(key, depth, storedScore, TT_EXACT, Move());
-		return terminalScore;
-	}
+	// checkmate or stalemate
+	auto terminalScore = [&](bool inCheck) {
+		Score score = inCheck ? MATED_SCORE + ply : 0;
+		searchTt->store(key, depth, scoreToTT(score, ply), TT_EXACT, Move());
+		return score;
+	};
 
 	if (depth == 0) {
+		// the horizon only needs to know whether a legal move exists to spot mates
+		if (gen.countLegalMoves() == 0) {
+			return terminalScore(gen.isInCheck());
+		}
+
 		bool quiescenceCancelled = false;
 		// WARN: do NOT invert alpha and beta here
-		Score evalScore = quiescence(alpha, beta, quiescenceCancelled);
+		Score evalScore = quiescence(alpha, beta, quiescenceCancelled, true);
 
 		if (quiescenceCancelled) {
 			searchCancelledOut = true;
@@ -316,20 +351,34 @@ Score Engine::negamax(int depth, Score alpha, Score beta, bool &searchCancelledO
 		return evalScore;
 	}
 
+	// inner nodes only pay for the legality of the moves they actually search
+	SearchStackEntry &ss = searchStack[ply];
+	ss.moveCount = gen.generatePseudoLegalMoves(ss.moves, ss.inCheck);
+	if (ss.moveCount == 0) {
+		return terminalScore(ss.inCheck);
+	}
+
 	Score bestScore = -INF;
 	Move bestMoveLocal;
+	int legalMoveCount = 0;
 
-	int moveScores[MAX_MOVES];
-	scoreMoves(legalMoves, moveScores, searchPos, ttMove);
+	scoreMoves(ss.moves, ss.moveCount, ss.moveScores, searchPos, ttMove);
 
-	for (size_t i = 0; i < legalMoves.size(); i++) {
-		pickNext(legalMoves, moveScores, i);
-		const Move &move = legalMoves[i];
+	for (size_t i = 0; i < ss.moveCount; i++) {
+		pickNext(ss.moves, ss.moveCount, ss.moveScores, i);
+		const Move move = ss.moves[i];
 
-		searchPos.makeMove(move);
+		// evasions are generated fully legal
+		if (!ss.inCheck && !gen.isLegal(move)) {
+			continue;
+		}
+		legalMoveCount++;
+
+		searchTt->prefetch(searchPos.keyAfter(move));
+		makeSearchMove(move);
 		bool childCancelled = false;
 		Score childScore = -negamax(depth - 1, -beta, -alpha, childCancelled);
-		searchPos.undoMove();
+		undoSearchMove();
 
 		if (childCancelled) {
 			searchCancelledOut = true;
@@ -348,6 +397,10 @@ Score Engine::negamax(int depth, Score alpha, Score beta, bool &searchCancelledO
 		}
 	}
 
+	if (legalMoveCount == 0) {
+		return terminalScore(ss.inCheck);
+	}
+
 	TTFlag flag = TT_EXACT;
 	if (bestScore <= originalAlpha) {
 		flag = TT_UPPER;
@@ -361,11 +414,11 @@ Score Engine::negamax(int depth, Score alpha, Score beta, bool &searchCancelledO
 	return bestScore;
 }
 
-Score Engine::quiescence(Score alpha, Score beta, bool &searchCancelledOut) {
+Score Engine::quiescence(Score alpha, Score beta, bool &searchCancelledOut, bool includeChecks) {
 	searchCancelledOut = false;
 
 	if (searchPos.ply >= MAX_PLY - 1) {
-		return eval(searchPos);
+		return eval(searchPos, pawnTable, materialTable);
 	}
 
 	if (nodesSearched >= maxNodes || searchStopRequested) {
@@ -383,39 +436,57 @@ Score Engine::quiescence(Score alpha, Score beta, bool &searchCancelledOut) {
 		}
 	}
 
-	// generate captures to detect check status
-	MoveList moves = gen.generateLegalMoves(true);
-	bool inCheck = moves.inCheck();
+	SearchStackEntry &ss = searchStack[searchPos.ply];
+	const bool inCheck = gen.isInCheck();
+	size_t captureCount = 0;
 
-	// in check: need ALL legal moves (evasions), not just captures
+	Score bestScore;
 	if (inCheck) {
-		moves = gen.generateLegalMoves();
-		if (moves.size() == 0) {
+		// in check: need ALL legal moves (evasions), not just captures
+		ss.moveCount = gen.generateLegalMoves(ss.moves, ss.inCheck);
+		if (ss.moveCount == 0) {
 			return MATED_SCORE + searchPos.ply;
 		}
-	}
-
-	Score bestScore;
-	if (inCheck) {
 		bestScore = -INF;  // no stand-pat when in check — must escape
 	}
 	else {
-		bestScore = eval(searchPos);
+		bestScore = eval(searchPos, pawnTable, materialTable);
 		if (bestScore >= beta) return bestScore;
 		if (bestScore > alpha) alpha = bestScore;
+
+		ss.moveCount = gen.generatePseudoLegalMoves(ss.moves, ss.inCheck, true);
+		captureCount = ss.moveCount;
+
+		// quiet checks go after the captures, they catch mates & forks the captures miss
+		if (includeChecks) {
+			ss.moveCount = gen.generateQuietChecks(ss.moves, ss.moveCount);
+		}
 	}
 
-	int moveScores[MAX_MOVES];
-	scoreMoves(moves, moveScores, searchPos, Move());
+	scoreMoves(ss.moves, ss.moveCount, ss.moveScores, searchPos, Move());
 
-	for (size_t i = 0; i < moves.size(); i++) {
-		pickNext(moves, moveScores, i);
-		const Move &m = moves[i];
+	// on the first ply checking captures go first, the reply is then limited to evasions
+	if (includeChecks) {
+		static constexpr int CHECKING_CAPTURE_BONUS = 100'000;
+		for (size_t i = 0; i < captureCount; i++) {
+			if (gen.givesCheck(ss.moves[i])) {
+				ss.moveScores[i] += CHECKING_CAPTURE_BONUS;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < ss.moveCount; i++) {
+		pickNext(ss.moves, ss.moveCount, ss.moveScores, i);
+		const Move m = ss.moves[i];
+
+		if (!inCheck && !gen.isLegal(m)) {
+			continue;
+		}
 
-		searchPos.makeMove(m);
+		makeSearchMove(m);
 		bool childCancelled = false;
 		Score score = -quiescence(-beta, -alpha, childCancelled);
-		searchPos.undoMove();
+		undoSearchMove();
 
 		if (childCancelled) {
 			searchCancelledOut = true;
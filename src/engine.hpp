@@ -4,9 +4,12 @@
 #include <atomic>
 #include <cstdint>
 #include <thread>
+#include <vector>
 
+#include "material.hpp"
 #include "movegen.hpp"
 #include "movelist.hpp"
+#include "pawns.hpp"
 #include "position.hpp"
 #include "tt.hpp"
 
@@ -19,6 +22,15 @@ struct GoLimits {
 	MoveList searchMoves;
 };
 
+// per-ply search state, preallocated so the recursion keeps no move lists on the call stack
+struct SearchStackEntry {
+	Move moves[MAX_MOVES];
+	int moveScores[MAX_MOVES];
+	size_t moveCount;
+	bool inCheck;
+	BoardState boardBefore;  // board before the move made at this ply (copy-make only)
+};
+
 // single-threaded search engine
 class Engine {
    public:
@@ -30,14 +42,23 @@ class Engine {
    private:
 	void rootNegamax(const GoLimits &limits);
 	Score negamax(int depth, Score alpha, Score beta, bool &searchCancelledOut);
-	Score quiescence(Score alpha, Score beta, bool &searchCancelledOut);
+	// quiet checks are searched too when includeChecks is set (first quiescence ply only)
+	Score quiescence(Score alpha, Score beta, bool &searchCancelledOut, bool includeChecks = false);
+
+	// make/undo, or copy-make when built with KNIGHTRIDER_COPY_MAKE
+	void makeSearchMove(Move move);
+	void undoSearchMove(void);
 
 	Move bestMove;
 
 	// current search state
-	Position searchPos;            // WARN: will be modified during search
-	TranspositionTable *searchTt;  // NOTE: lifetime managed exteranlly by UCI engine
+	Position searchPos;             // WARN: will be modified during search
+	PositionHistory searchHistory;  // undo & repetition stacks of searchPos
+	PawnTable pawnTable;            // pawn structure cache of the search thread
+	MaterialTable materialTable;    // material analysis cache of the search thread
+	TranspositionTable *searchTt;   // NOTE: lifetime managed exteranlly by UCI engine
 	MoveGenerator gen = MoveGenerator(&searchPos);
+	std::vector<SearchStackEntry> searchStack = std::vector<SearchStackEntry>(MAX_PLY + 1);
 	uint64_t maxNodes;       // set if nodeLimit is set in GoLimits, otherwise UINT64_MAX
 	uint64_t nodesSearched;  // how many nodes were explored until now
 
@@ -1,16 +1,10 @@
 #include "eval.hpp"
 
-#include <bit>
+#include <algorithm>
 #include <cstdint>
 
 #include "position.hpp"
 
-static constexpr Score PAWN_VAL = 100;
-static constexpr Score KNIGHT_VAL = 320;
-static constexpr Score BISHOP_VAL = 330;
-static constexpr Score ROOK_VAL = 500;
-static constexpr Score QUEEN_VAL = 900;
-
 static_assert(WHITE == 0 && BLACK == 1);
 static_assert(PT_PAWN == 0 && PT_KNIGHT == 1 && PT_BISHOP == 2 && PT_ROOK == 3 && PT_QUEEN == 4 &&
               PT_KING == 5 && PT_NULL == 6);
@@ -58,7 +52,7 @@ alignas(64) static constexpr int16_t PST[6][64] = {
         -5,  0,   5,   5,  5,  5,   0,   -5,  -10, 0,   5,   5,  5,  5,   0,   -10,
         -10, 0,   0,   0,  0,  0,   0,   -10, -20, -10, -10, -5, -5, -10, -10, -20,
     },
-    // 5: king (middlegame)
+    // 5: king (middlegame, the endgame table is KING_EG)
     {
         20,  30,  10,  0,   0,   10,  30,  20,  20,  20,  0,   0,   0,   0,   20,  20,
         -10, -20, -20, -20, -20, -20, -20, -10, -20, -30, -30, -40, -40, -30, -30, -20,
@@ -67,55 +61,47 @@ alignas(64) static constexpr int16_t PST[6][64] = {
     },
 };
 
-static inline Score materialScore(const Position& pos) {
-	const Bitboard* p = pos.pieces;
-	Score w = 0, b = 0;
-
-	w += std::popcount(p[PT_PAWN + WHITE * 6]) * PAWN_VAL;
-	w += std::popcount(p[PT_KNIGHT + WHITE * 6]) * KNIGHT_VAL;
-	w += std::popcount(p[PT_BISHOP + WHITE * 6]) * BISHOP_VAL;
-	w += std::popcount(p[PT_ROOK + WHITE * 6]) * ROOK_VAL;
-	w += std::popcount(p[PT_QUEEN + WHITE * 6]) * QUEEN_VAL;
-
-	b += std::popcount(p[PT_PAWN + BLACK * 6]) * PAWN_VAL;
-	b += std::popcount(p[PT_KNIGHT + BLACK * 6]) * KNIGHT_VAL;
-	b += std::popcount(p[PT_BISHOP + BLACK * 6]) * BISHOP_VAL;
-	b += std::popcount(p[PT_ROOK + BLACK * 6]) * ROOK_VAL;
-	b += std::popcount(p[PT_QUEEN + BLACK * 6]) * QUEEN_VAL;
-
-	return w - b;  // white - black
-}
-
-static inline Score pstScore(const Position& pos) {
-	Score score = 0;
-	const Bitboard* p = pos.pieces;
+// king endgame table, the king belongs in the center once the heavy pieces are gone
+alignas(64) static constexpr int16_t KING_EG[64] = {
+    -50, -30, -30, -30, -30, -30, -30, -50, -30, -30, 0,   0,   0,   0,   -30, -30,
+    -30, -10, 20,  30,  30,  20,  -10, -30, -30, -10, 30,  40,  40,  30,  -10, -30,
+    -30, -10, 30,  40,  40,  30,  -10, -30, -30, -10, 20,  30,  30,  20,  -10, -30,
+    -30, -20, -10, 0,   0,   -10, -20, -30, -50, -40, -30, -30, -30, -30, -40, -50,
+};
 
+// white pieces use the tables as they are, black pieces mirrored & negated
+static constexpr std::array<std::array<Score, 64>, 12> makePsq(bool endgame) {
+	std::array<std::array<Score, 64>, 12> psq{};
 	for (int pt = 0; pt < 6; pt++) {
-		const int16_t* pst = PST[pt];
-
-		// white
-		Bitboard bbW = p[pt + WHITE * 6];
-		while (bbW) {
-			int sq = std::countr_zero(bbW);
-			score += pst[sq];
-			bbW &= bbW - 1;
-		}
-
-		Bitboard bbB = p[pt + BLACK * 6];
-		while (bbB) {
-			int sq = std::countr_zero(bbB);
-			score -= pst[MIRROR[sq]];
-			bbB &= bbB - 1;
+		const int16_t* pst = endgame && pt == PT_KING ? KING_EG : PST[pt];
+		for (int sq = 0; sq < 64; sq++) {
+			psq[WHITE * 6 + pt][sq] = PIECE_VAL[pt] + pst[sq];
+			psq[BLACK * 6 + pt][sq] = -(PIECE_VAL[pt] + pst[MIRROR[sq]]);
 		}
 	}
-	return score;  // white - black
+	return psq;
 }
 
-Score eval(const Position& position) {
-	Score score = 0;
+constexpr std::array<std::array<Score, 64>, 12> PSQ_MG = makePsq(false);
+constexpr std::array<std::array<Score, 64>, 12> PSQ_EG = makePsq(true);
+
+MULTIVERSION Score eval(const Position& position, PawnTable& pawnTable,
+                        MaterialTable& materialTable) {
+	// known endgames have their own evaluation
+	const MaterialEntry& material = materialTable.probe(position);
+	if (material.evaluate) {
+		const Score score = material.evaluate(position);
+		return position.usColor == WHITE ? score : -score;
+	}
+
+	const PawnEntry& pawns = pawnTable.probe(position);
+	const Score mg = position.psqMg + pawns.mg + pawnShieldScore(position);
+	Score eg = position.psqEg + pawns.eg;
+	eg = eg * material.scaleFactor(position, eg > 0 ? WHITE : BLACK) / SCALE_NORMAL;
 
-	score += materialScore(position);
-	score += pstScore(position);
+	// taper between the midgame & the endgame sums by the remaining material
+	const int phase = std::min(position.phase, PHASE_MAX);
+	Score score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
 
 	if (position.usColor == BLACK) score = -score;
 
@@ -1,9 +1,29 @@
 #ifndef EVAL_HPP
 #define EVAL_HPP
 
+#include <array>
+
+#include "material.hpp"
 #include "misc.hpp"
+#include "pawns.hpp"
 #include "position.hpp"
 
-Score eval(const Position &position);
+constexpr Score PAWN_VAL = 100;
+constexpr Score KNIGHT_VAL = 320;
+constexpr Score BISHOP_VAL = 330;
+constexpr Score ROOK_VAL = 500;
+constexpr Score QUEEN_VAL = 900;
+constexpr Score PIECE_VAL[6] = {PAWN_VAL, KNIGHT_VAL, BISHOP_VAL, ROOK_VAL, QUEEN_VAL, 0};
+
+// material + piece-square value of each piece index on each square, white positive. Position sums
+// them up incrementally for the midgame & the endgame
+extern const std::array<std::array<Score, 64>, 12> PSQ_MG;
+extern const std::array<std::array<Score, 64>, 12> PSQ_EG;
+
+// game phase of the non-pawn material, PHASE_MAX with all of it on the board
+constexpr int PHASE_WEIGHT[6] = {0, 1, 1, 2, 4, 0};
+constexpr int PHASE_MAX = 24;
+
+Score eval(const Position &position, PawnTable &pawnTable, MaterialTable &materialTable);
 
 #endif  // EVAL_HPP
@@ -0,0 +1,355 @@
+#include "material.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdlib>
+
+#include "bitboards.hpp"
+#include "eval.hpp"
+
+static constexpr Bitboard LIGHT_SQUARES = 0x55AA55AA55AA55AAULL;
+
+static constexpr int fileOf(int sq) { return sq & 7; }
+static constexpr int rankOf(int sq) { return sq >> 3; }
+static inline int distance(int a, int b) {
+	return std::max(std::abs(fileOf(a) - fileOf(b)), std::abs(rankOf(a) - rankOf(b)));
+}
+
+// bonus for driving the losing king to the edge & for bringing the winning king close to it
+static constexpr std::array<Score, 64> PUSH_TO_EDGE = [] {
+	std::array<Score, 64> table{};
+	for (int sq = 0; sq < 64; sq++) {
+		const int fileDist = std::max(3 - fileOf(sq), fileOf(sq) - 4);
+		const int rankDist = std::max(3 - rankOf(sq), rankOf(sq) - 4);
+		table[sq] = 20 * (fileDist + rankDist);
+	}
+	return table;
+}();
+static constexpr Score PUSH_CLOSE[8] = {0, 0, 100, 80, 60, 40, 20, 10};
+
+/*
+ * KPK bitbase. Every KPK position is normalized to a white pawn on files a-d & classified by
+ * retrograde analysis before the first search; the table keeps one bit per position, set when
+ * white wins.
+ */
+static constexpr int KPK_SIZE = 2 * 24 * 64 * 64;
+
+// results, bits so the results of the successors can be or'ed together
+static constexpr uint8_t KPK_INVALID = 0;
+static constexpr uint8_t KPK_UNKNOWN = 1;
+static constexpr uint8_t KPK_DRAW = 2;
+static constexpr uint8_t KPK_WIN = 4;
+
+static constexpr int kpkIndex(int stm, int whiteKing, int blackKing, int pawnSq) {
+	return whiteKing | (blackKing << 6) | (stm << 12) | (fileOf(pawnSq) << 13) |
+	       ((6 - rankOf(pawnSq)) << 15);
+}
+
+static Bitboard whitePawnAttacks(int sq) {
+	const Bitboard pawn = 1ULL << sq;
+	return ((pawn << 7) & ~FILE_H) | ((pawn << 9) & ~FILE_A);
+}
+
+static uint8_t kpkInitial(int idx) {
+	const int whiteKing = idx & 63;
+	const int blackKing = (idx >> 6) & 63;
+	const int stm = (idx >> 12) & 1;
+	const int pawnSq = 8 * (6 - (idx >> 15)) + ((idx >> 13) & 3);
+	const Bitboard blackKingBB = 1ULL << blackKing;
+
+	if (distance(whiteKing, blackKing) <= 1 || whiteKing == pawnSq || blackKing == pawnSq ||
+	    (stm == WHITE && (whitePawnAttacks(pawnSq) & blackKingBB))) {
+		return KPK_INVALID;
+	}
+
+	// the pawn promotes without being captured
+	if (stm == WHITE && rankOf(pawnSq) == 6 && whiteKing != pawnSq + 8 &&
+	    (distance(blackKing, pawnSq + 8) > 1 || distance(whiteKing, pawnSq + 8) == 1)) {
+		return KPK_WIN;
+	}
+
+	// stalemate, or the black king takes an undefended pawn
+	if (stm == BLACK) {
+		const Bitboard safe =
+		    KING_MOVE_MASK[blackKing] & ~(KING_MOVE_MASK[whiteKing] | whitePawnAttacks(pawnSq));
+		if ((!safe && !(whitePawnAttacks(pawnSq) & blackKingBB)) ||
+		    (KING_MOVE_MASK[blackKing] & ~KING_MOVE_MASK[whiteKing] & (1ULL << pawnSq))) {
+			return KPK_DRAW;
+		}
+	}
+
+	return KPK_UNKNOWN;
+}
+
+// result of a position from the results of its successors
+static uint8_t kpkClassify(const std::vector<uint8_t> &db, int idx) {
+	const int whiteKing = idx & 63;
+	const int blackKing = (idx >> 6) & 63;
+	const int stm = (idx >> 12) & 1;
+	const int pawnSq = 8 * (6 - (idx >> 15)) + ((idx >> 13) & 3);
+
+	const uint8_t good = stm == WHITE ? KPK_WIN : KPK_DRAW;
+	const uint8_t bad = stm == WHITE ? KPK_DRAW : KPK_WIN;
+
+	uint8_t r = KPK_INVALID;
+	for (Bitboard b = KING_MOVE_MASK[stm == WHITE ? whiteKing : blackKing]; b; b &= b - 1) {
+		const int sq = std::countr_zero(b);
+		r |= stm == WHITE ? db[kpkIndex(BLACK, sq, blackKing, pawnSq)]
+		                  : db[kpkIndex(WHITE, whiteKing, sq, pawnSq)];
+	}
+
+	// pawn pushes, a push onto a king lands on an invalid entry
+	if (stm == WHITE) {
+		if (rankOf(pawnSq) < 6) {
+			r |= db[kpkIndex(BLACK, whiteKing, blackKing, pawnSq + 8)];
+		}
+		if (rankOf(pawnSq) == 1 && pawnSq + 8 != whiteKing && pawnSq + 8 != blackKing) {
+			r |= db[kpkIndex(BLACK, whiteKing, blackKing, pawnSq + 16)];
+		}
+	}
+
+	return (r & good) ? good : (r & KPK_UNKNOWN) ? KPK_UNKNOWN : bad;
+}
+
+static std::vector<uint64_t> buildKpk(void) {
+	std::vector<uint8_t> db(KPK_SIZE);
+	for (int idx = 0; idx < KPK_SIZE; idx++) {
+		db[idx] = kpkInitial(idx);
+	}
+
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (int idx = 0; idx < KPK_SIZE; idx++) {
+			if (db[idx] == KPK_UNKNOWN && (db[idx] = kpkClassify(db, idx)) != KPK_UNKNOWN) {
+				changed = true;
+			}
+		}
+	}
+
+	std::vector<uint64_t> bits(KPK_SIZE / 64);
+	for (int idx = 0; idx < KPK_SIZE; idx++) {
+		if (db[idx] == KPK_WIN) bits[idx / 64] |= 1ULL << (idx % 64);
+	}
+	return bits;
+}
+
+// empty until initKpkBitbase, written only while no search is running
+static std::vector<uint64_t> kpkBitbase;
+
+void initKpkBitbase(void) {
+	if (kpkBitbase.empty()) {
+		kpkBitbase = buildKpk();
+	}
+}
+
+static bool kpkWins(int stm, int whiteKing, int blackKing, int pawnSq) {
+	assert(!kpkBitbase.empty());
+	const int idx = kpkIndex(stm, whiteKing, blackKing, pawnSq);
+	return (kpkBitbase[idx / 64] >> (idx % 64)) & 1;
+}
+
+/*
+ * endgame evaluators, each specialised on the color of the side with the extra material
+ */
+template <int StrongColor>
+static inline int kingSquare(const Position &pos) {
+	return std::countr_zero(pos.pieces[StrongColor * 6 + PT_KING]);
+}
+
+// a lone king against enough material to mate: drive it to the edge
+template <int StrongColor>
+static Score kxkT(const Position &pos) {
+	constexpr int Weak = StrongColor ^ 1;
+	const int strongKing = kingSquare<StrongColor>(pos);
+	const int weakKing = kingSquare<Weak>(pos);
+
+	Score score = KNOWN_WIN + PUSH_TO_EDGE[weakKing] + PUSH_CLOSE[distance(strongKing, weakKing)];
+	for (int pt = PT_PAWN; pt < PT_KING; pt++) {
+		score += std::popcount(pos.pieces[StrongColor * 6 + pt]) * PIECE_VAL[pt];
+	}
+
+	return StrongColor == WHITE ? score : -score;
+}
+
+// bishop & knight: only the corners of the bishop's color are mates
+template <int StrongColor>
+static Score kbnkT(const Position &pos) {
+	constexpr int Weak = StrongColor ^ 1;
+	const int strongKing = kingSquare<StrongColor>(pos);
+	const int weakKing = kingSquare<Weak>(pos);
+	const bool lightBishop = pos.pieces[StrongColor * 6 + PT_BISHOP] & LIGHT_SQUARES;
+
+	// distance from the long diagonal between the two wrong corners, a1 & h8 are dark
+	const int sq = lightBishop ? weakKing ^ 56 : weakKing;
+	const Score pushToCorner = 50 * std::abs(7 - rankOf(sq) - fileOf(sq));
+
+	const Score score = KNOWN_WIN + KNIGHT_VAL + BISHOP_VAL + PUSH_TO_EDGE[weakKing] + pushToCorner +
+	                    PUSH_CLOSE[distance(strongKing, weakKing)];
+	return StrongColor == WHITE ? score : -score;
+}
+
+// bishops only: the mate needs bishops of both colors, same colored ones can't force it
+template <int StrongColor>
+static Score kbbkT(const Position &pos) {
+	const Bitboard bishops = pos.pieces[StrongColor * 6 + PT_BISHOP];
+	if (!(bishops & LIGHT_SQUARES) || !(bishops & ~LIGHT_SQUARES)) return 0;
+	return kxkT<StrongColor>(pos);
+}
+
+// king & pawn against king, exact by the bitbase
+template <int StrongColor>
+static Score kpkT(const Position &pos) {
+	constexpr int Weak = StrongColor ^ 1;
+	int strongKing = kingSquare<StrongColor>(pos);
+	int weakKing = kingSquare<Weak>(pos);
+	int pawnSq = std::countr_zero(pos.pieces[StrongColor * 6 + PT_PAWN]);
+	int stm = pos.usColor;
+
+	// normalize to a white pawn on files a-d
+	if constexpr (StrongColor == BLACK) {
+		strongKing ^= 56;
+		weakKing ^= 56;
+		pawnSq ^= 56;
+		stm ^= 1;
+	}
+	if (fileOf(pawnSq) >= 4) {
+		strongKing ^= 7;
+		weakKing ^= 7;
+		pawnSq ^= 7;
+	}
+
+	if (!kpkWins(stm, strongKing, weakKing, pawnSq)) return 0;
+
+	const Score score = KNOWN_WIN + PAWN_VAL + 20 * rankOf(pawnSq);
+	return StrongColor == WHITE ? score : -score;
+}
+
+// rook & pawn against rook: drawish with the defending king in front of the pawn
+template <int StrongColor>
+static int krpkrT(const Position &pos) {
+	constexpr int Weak = StrongColor ^ 1;
+	int strongKing = kingSquare<StrongColor>(pos);
+	int weakKing = kingSquare<Weak>(pos);
+	int pawnSq = std::countr_zero(pos.pieces[StrongColor * 6 + PT_PAWN]);
+
+	if constexpr (StrongColor == BLACK) {
+		strongKing ^= 56;
+		weakKing ^= 56;
+		pawnSq ^= 56;
+	}
+
+	const bool weakKingInFront =
+	    std::abs(fileOf(weakKing) - fileOf(pawnSq)) <= 1 && rankOf(weakKing) > rankOf(pawnSq);
+	const bool strongKingInFront = rankOf(strongKing) > rankOf(pawnSq);
+
+	if (weakKingInFront && !strongKingInFront) {
+		return rankOf(pawnSq) <= 4 ? 8 : 24;
+	}
+	return SCALE_NORMAL;
+}
+
+// a bishop each & pawns: opposite colored bishops hold many pawn-down endgames
+static int bishopsScale(const Position &pos) {
+	const bool whiteLight = pos.pieces[WHITE * 6 + PT_BISHOP] & LIGHT_SQUARES;
+	const bool blackLight = pos.pieces[BLACK * 6 + PT_BISHOP] & LIGHT_SQUARES;
+	return whiteLight != blackLight ? 24 : SCALE_NORMAL;
+}
+
+template <int Factor>
+static int constantScale(const Position &) {
+	return Factor;
+}
+
+bool MaterialEntry::isInsufficient(const Position &position) const noexcept {
+	if (insufficient) return true;
+	if (!bishopsOnly) return false;
+
+	const bool whiteLight = position.pieces[WHITE * 6 + PT_BISHOP] & LIGHT_SQUARES;
+	const bool blackLight = position.pieces[BLACK * 6 + PT_BISHOP] & LIGHT_SQUARES;
+	return whiteLight == blackLight;
+}
+
+// picks the evaluation hooks of a material configuration from its piece counts
+template <int StrongColor>
+static void analyseSideT(MaterialEntry &entry, const int count[2][5], const Score npm[2]) {
+	constexpr int Weak = StrongColor ^ 1;
+	const int *strong = count[StrongColor];
+	const int *weak = count[Weak];
+	const bool weakBare = npm[Weak] == 0 && weak[PT_PAWN] == 0;
+	const int strongPieces = strong[PT_KNIGHT] + strong[PT_BISHOP] + strong[PT_ROOK] + strong[PT_QUEEN];
+
+	if (weakBare && !entry.evaluate) {
+		if (strong[PT_PAWN] == 1 && strongPieces == 0) {
+			entry.evaluate = &kpkT<StrongColor>;
+		}
+		else if (strong[PT_PAWN] == 0 && strong[PT_KNIGHT] == 1 && strong[PT_BISHOP] == 1 &&
+		         strongPieces == 2) {
+			entry.evaluate = &kbnkT<StrongColor>;
+		}
+		else if (strong[PT_PAWN] == 0 && strong[PT_BISHOP] == strongPieces && strongPieces >= 2) {
+			entry.evaluate = &kbbkT<StrongColor>;
+		}
+		else if (npm[StrongColor] >= ROOK_VAL &&
+		         !(strong[PT_PAWN] == 0 && strong[PT_KNIGHT] == strongPieces && strongPieces <= 2)) {
+			entry.evaluate = &kxkT<StrongColor>;
+		}
+	}
+
+	if (strong[PT_PAWN] == 1 && strong[PT_ROOK] == 1 && strongPieces == 1 && weak[PT_PAWN] == 0 &&
+	    weak[PT_ROOK] == 1 && npm[Weak] == ROOK_VAL) {
+		entry.scale[StrongColor] = &krpkrT<StrongColor>;
+	}
+	else if (strong[PT_PAWN] == 0 && strong[PT_KNIGHT] == 2 && strongPieces == 2 && weakBare) {
+		entry.scale[StrongColor] = &constantScale<SCALE_DRAW>;
+	}
+	// without pawns a small material edge rarely wins
+	else if (strong[PT_PAWN] == 0 && npm[StrongColor] - npm[Weak] <= BISHOP_VAL) {
+		entry.scale[StrongColor] = npm[StrongColor] < ROOK_VAL ? &constantScale<SCALE_DRAW>
+		                           : npm[Weak] <= BISHOP_VAL   ? &constantScale<4>
+		                                                       : &constantScale<14>;
+	}
+}
+
+static void analyse(MaterialEntry &entry, uint64_t key) {
+	entry = MaterialEntry{key};
+
+	int count[2][5];
+	Score npm[2] = {0, 0};
+	for (int color = 0; color < 2; color++) {
+		for (int pt = PT_PAWN; pt < PT_KING; pt++) {
+			count[color][pt] = materialCount(key, color * 6 + pt);
+			if (pt != PT_PAWN) npm[color] += count[color][pt] * PIECE_VAL[pt];
+		}
+	}
+
+	const int pawns = count[WHITE][PT_PAWN] + count[BLACK][PT_PAWN];
+	const int heavies = count[WHITE][PT_ROOK] + count[BLACK][PT_ROOK] + count[WHITE][PT_QUEEN] +
+	                    count[BLACK][PT_QUEEN];
+	const int knights = count[WHITE][PT_KNIGHT] + count[BLACK][PT_KNIGHT];
+	const int bishops = count[WHITE][PT_BISHOP] + count[BLACK][PT_BISHOP];
+
+	// a lone minor piece or nothing at all
+	entry.insufficient = pawns == 0 && heavies == 0 && knights + bishops <= 1;
+	const bool bishopEach = heavies == 0 && knights == 0 && count[WHITE][PT_BISHOP] == 1 &&
+	                        count[BLACK][PT_BISHOP] == 1;
+	entry.bishopsOnly = bishopEach && pawns == 0;
+	if (entry.insufficient) return;
+
+	analyseSideT<WHITE>(entry, count, npm);
+	analyseSideT<BLACK>(entry, count, npm);
+
+	if (bishopEach && pawns > 0) {
+		entry.scale[WHITE] = entry.scale[BLACK] = &bishopsScale;
+	}
+}
+
+const MaterialEntry &MaterialTable::probe(const Position &position) {
+	const uint64_t key = position.materialKey;
+	MaterialEntry &entry = entries[(key * 0x9E3779B97F4A7C15ULL) >> (64 - std::countr_zero(ENTRIES))];
+	if (entry.key != key) {
+		analyse(entry, key);
+	}
+	return entry;
+}
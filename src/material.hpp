@@ -0,0 +1,51 @@
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "misc.hpp"
+#include "position.hpp"
+
+// score of a won endgame before the conversion terms, far away from the mate scores
+constexpr Score KNOWN_WIN = 10'000;
+
+// scale factors for the endgame half of the evaluation
+constexpr int SCALE_NORMAL = 64;
+constexpr int SCALE_DRAW = 0;
+
+using EndgameEval = Score (*)(const Position &position);  // white positive
+using EndgameScale = int (*)(const Position &position);   // 0 - SCALE_NORMAL
+
+// evaluation hooks of one material configuration
+struct MaterialEntry {
+	uint64_t key;                    // material key of the configuration
+	EndgameEval evaluate = nullptr;  // replaces the evaluation of a known endgame
+	EndgameScale scale[2] = {};      // scales the endgame score when that color is ahead
+	bool insufficient = false;       // neither side can mate
+	bool bishopsOnly = false;        // a bishop each & nothing else, drawn with same colored bishops
+
+	bool isInsufficient(const Position &position) const noexcept;
+	inline int scaleFactor(const Position &position, int strongColor) const {
+		return scale[strongColor] ? scale[strongColor](position) : SCALE_NORMAL;
+	}
+};
+
+// builds the KPK bitbase the endgame evaluation needs, once; too slow for a constexpr table & kept
+// out of startup, so it is done before the first search (isready, ucinewgame or go)
+void initKpkBitbase(void);
+
+// per-thread cache of the material analysis, indexed by the material key
+class MaterialTable {
+   public:
+	const MaterialEntry &probe(const Position &position);  // analyses the material on a miss
+
+   private:
+	static constexpr size_t ENTRIES = 1 << 13;  // 320 KiB
+	static constexpr uint64_t NO_KEY = ~0ULL;    // king counts are never set, so no position has it
+
+	std::vector<MaterialEntry> entries = std::vector<MaterialEntry>(ENTRIES, MaterialEntry{NO_KEY});
+};
+
+#endif  // MATERIAL_HPP
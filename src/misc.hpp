@@ -6,6 +6,10 @@
 #include <limits>
 #include <mutex>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
 // types
 using Bitboard = uint64_t;
 using Score = int32_t;
@@ -33,6 +37,47 @@ constexpr Score INF = std::numeric_limits<int32_t>::max();
 constexpr int MAX_PLY = std::numeric_limits<int8_t>::max();
 constexpr int MAX_MOVES = 256;
 
+// portable builds compile the hot kernels for several x86-64 ISA levels, the best clone for the
+// running cpu is picked once at startup
+#if defined(KNIGHTRIDER_MULTIVERSION) && defined(__x86_64__) && defined(__GNUC__) && \
+    !defined(__clang__)
+#define HAS_MULTIVERSION
+#define MULTIVERSION \
+	__attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#elif defined(KNIGHTRIDER_MULTIVERSION) && defined(__clang__)
+// a portable build without the clones would silently run baseline x86-64 code everywhere
+#error "KNIGHTRIDER_MULTIVERSION needs GCC, Clang cannot clone the templated kernels"
+#else
+#define MULTIVERSION
+#endif
+
+// high 64 bits of the 128 bit product a * b
+inline uint64_t mulHi64(uint64_t a, uint64_t b) {
+#if defined(__GNUC__)
+	__extension__ typedef unsigned __int128 uint128;
+	return static_cast<uint64_t>((static_cast<uint128>(a) * b) >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	return __umulh(a, b);
+#else
+	const uint64_t aLo = a & 0xFFFFFFFFULL, aHi = a >> 32;
+	const uint64_t bLo = b & 0xFFFFFFFFULL, bHi = b >> 32;
+	const uint64_t mid1 = aHi * bLo + ((aLo * bLo) >> 32);
+	const uint64_t mid2 = aLo * bHi + (mid1 & 0xFFFFFFFFULL);
+	return aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+#endif
+}
+
+// hints the cpu to pull the cache line of addr in, no-op where unsupported
+inline void prefetch(const void* addr) {
+#if defined(__GNUC__)
+	__builtin_prefetch(addr);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_prefetch(static_cast<const char*>(addr), _MM_HINT_T0);
+#else
+	(void)addr;
+#endif
+}
+
 // safe printing
 extern std::mutex printMutex;
 
@@ -7,34 +7,43 @@
 
 #include "misc.hpp"
 
+// 16 bit move: from square (6 bits), to square (6 bits), promotion piece (2 bits) and the kind
+// of special move (2 bits); the moving piece is looked up on the board
 class Move {
    public:
 	Move(void) = default;
-	inline Move(Bitboard from, Bitboard to, int movingPt, int promoPt, bool isCastling, bool isEp);
+	inline Move(Bitboard from, Bitboard to, int promoPt, bool isCastling, bool isEp);
 
 	inline bool isNull(void) const;
 	inline bool operator==(const Move& other) const;
 
 	inline std::string toLan(void) const;
+	inline int getFromSq(void) const;
+	inline int getToSq(void) const;
 	inline Bitboard getFrom(void) const;
 	inline Bitboard getTo(void) const;
-	inline int getMovingPt(void) const;
 	inline int getPromoPt(void) const;
 	inline bool getIsCastling(void) const;
 	inline bool getIsEp(void) const;
 
    private:
-	uint32_t move = 0;
+	static constexpr uint16_t SPECIAL_PROMOTION = 1 << 14;
+	static constexpr uint16_t SPECIAL_EP = 2 << 14;
+	static constexpr uint16_t SPECIAL_CASTLING = 3 << 14;
+	static constexpr uint16_t SPECIAL_MASK = 3 << 14;
+
+	uint16_t move = 0;
 };
 
-inline Move::Move(Bitboard from, Bitboard to, int movingPt, int promoPt, bool isCastling, bool isEp)
-    : move(0) {
-	move |= std::countr_zero(from) & 0x3F;
-	move |= static_cast<uint32_t>(std::countr_zero(to) & 0x3F) << 6;
-	move |= static_cast<uint32_t>(movingPt & 7) << 12;
-	move |= static_cast<uint32_t>(promoPt & 7) << 15;
-	move |= static_cast<uint32_t>(isCastling & 1) << 18;
-	move |= static_cast<uint32_t>(isEp & 1) << 19;
+inline Move::Move(Bitboard from, Bitboard to, int promoPt, bool isCastling, bool isEp) {
+	uint16_t special = promoPt != PT_NULL ? SPECIAL_PROMOTION
+	                   : isEp             ? SPECIAL_EP
+	                   : isCastling       ? SPECIAL_CASTLING
+	                                      : 0;
+	uint16_t promo = promoPt != PT_NULL ? static_cast<uint16_t>((promoPt - PT_KNIGHT) << 12) : 0;
+
+	move = static_cast<uint16_t>(std::countr_zero(from) | (std::countr_zero(to) << 6)) | promo |
+	       special;
 }
 
 inline std::string Move::toLan(void) const {
@@ -42,9 +51,9 @@ inline std::string Move::toLan(void) const {
 		return "0000";  // null move
 	}
 
-	int fromSq = move & 0x3F;
-	int toSq = (move >> 6) & 0x3F;
-	int promoPt = (move >> 15) & 0x7;
+	int fromSq = getFromSq();
+	int toSq = getToSq();
+	int promoPt = getPromoPt();
 
 	char fromFile = char('a' + (fromSq & 7));
 	char fromRank = char('1' + (fromSq >> 3));
@@ -70,11 +79,14 @@ inline bool Move::isNull(void) const { return move == 0; }
 
 inline bool Move::operator==(const Move& other) const { return move == other.move; }
 
-inline Bitboard Move::getFrom(void) const { return 1ULL << (move & 0x3F); }
-inline Bitboard Move::getTo(void) const { return 1ULL << ((move >> 6) & 0x3F); }
-inline int Move::getMovingPt(void) const { return (move >> 12) & 7; }
-inline int Move::getPromoPt(void) const { return (move >> 15) & 7; }
-inline bool Move::getIsCastling(void) const { return (move >> 18) & 1; }
-inline bool Move::getIsEp(void) const { return (move >> 19) & 1; }
+inline int Move::getFromSq(void) const { return move & 0x3F; }
+inline int Move::getToSq(void) const { return (move >> 6) & 0x3F; }
+inline Bitboard Move::getFrom(void) const { return 1ULL << getFromSq(); }
+inline Bitboard Move::getTo(void) const { return 1ULL << getToSq(); }
+inline int Move::getPromoPt(void) const {
+	return (move & SPECIAL_MASK) == SPECIAL_PROMOTION ? PT_KNIGHT + ((move >> 12) & 3) : PT_NULL;
+}
+inline bool Move::getIsCastling(void) const { return (move & SPECIAL_MASK) == SPECIAL_CASTLING; }
+inline bool Move::getIsEp(void) const { return (move & SPECIAL_MASK) == SPECIAL_EP; }
 
 #endif  // MOVE_HPP
@@ -5,79 +5,188 @@
 
 #include "bitboards.hpp"
 
-static inline Bitboard getRookAttacks(int sq, Bitboard occ) {
-	Bitboard blockers = occ & ROOK_BLOCKER_MASK[sq];
-	return ROOK_ATTACK_MASK[sq][(blockers * ROOK_MAGIC[sq]) >> (64 - ROOK_RELEVANT_BITS[sq])];
+static inline void addMovesToList(Move *&out, Bitboard from, Bitboard allMoves) {
+	while (allMoves) {
+		Bitboard currMove = allMoves & -allMoves;
+		*out++ = Move(from, currMove, PT_NULL, false, false);
+		allMoves &= allMoves - 1;
+	}
 }
 
-static inline Bitboard getBishopAttacks(int sq, Bitboard occ) {
-	Bitboard blockers = occ & BISHOP_BLOCKER_MASK[sq];
-	return BISHOP_ATTACK_MASK[sq][(blockers * BISHOP_MAGIC[sq]) >> (64 - BISHOP_RELEVANT_BITS[sq])];
+// adds a move from every square in fromSet to a single target square
+static inline void addMovesToSquare(Move *&out, Bitboard fromSet, Bitboard to) {
+	while (fromSet) {
+		Bitboard currFrom = fromSet & -fromSet;
+		*out++ = Move(currFrom, to, PT_NULL, false, false);
+		fromSet &= fromSet - 1;
+	}
 }
 
-static inline void addMovesToList(MoveList &moveList, Bitboard from, Bitboard allMoves, int pt) {
-	while (allMoves) {
-		Bitboard currMove = allMoves & -allMoves;
-		moveList.push_back(Move(from, currMove, pt, PT_NULL, false, false));
-		allMoves &= allMoves - 1;
+// shifts towards higher squares for positive Delta, lower squares for negative Delta
+template <int Delta>
+static constexpr Bitboard shiftBy(Bitboard bb) {
+	if constexpr (Delta > 0)
+		return bb << Delta;
+	else
+		return bb >> -Delta;
+}
+
+// adds a single pawn move, expanding it into all four promotions on the last rank
+template <int UsColor>
+static inline Move *addPawnMoveT(Move *out, Bitboard from, Bitboard to) {
+	constexpr Bitboard PromoRank = UsColor == WHITE ? RANK_8 : RANK_1;
+
+	if (to & PromoRank) {
+		*out++ = Move(from, to, PT_KNIGHT, false, false);
+		*out++ = Move(from, to, PT_BISHOP, false, false);
+		*out++ = Move(from, to, PT_ROOK, false, false);
+		*out++ = Move(from, to, PT_QUEEN, false, false);
 	}
+	else {
+		*out++ = Move(from, to, PT_NULL, false, false);
+	}
+	return out;
+}
+
+// adds the pawn moves for a set of targets that were all reached with the same shift;
+// the origin square is recovered by shifting back
+template <int UsColor, int Delta>
+static inline Move *addPawnMovesT(Move *out, Bitboard targets) {
+	while (targets) {
+		Bitboard to = targets & -targets;
+		out = addPawnMoveT<UsColor>(out, shiftBy<-Delta>(to), to);
+		targets &= targets - 1;
+	}
+	return out;
+}
+
+// runs fn for the side to move & the slider backend picked at startup, so the lookups inside the
+// templates compile to a single index function instead of branching on the backend every time
+template <typename Fn>
+static inline auto dispatchT(int usColor, Fn &&fn) {
+#if defined(HAS_PEXT)
+	if (sliderBackend == SLIDER_PEXT) {
+		return usColor == WHITE ? fn.template operator()<WHITE, SLIDER_PEXT>()
+		                        : fn.template operator()<BLACK, SLIDER_PEXT>();
+	}
+#endif
+	return usColor == WHITE ? fn.template operator()<WHITE, SLIDER_MAGIC>()
+	                        : fn.template operator()<BLACK, SLIDER_MAGIC>();
 }
 
 MoveGenerator::MoveGenerator(Position *positionPtr)
     : position(positionPtr), P(positionPtr->pieces) {}
 
 MoveList MoveGenerator::generateLegalMoves(bool onlyCaptures) const {
-	if (position->usColor == WHITE) {
-		return onlyCaptures ? generateLegalMovesT<WHITE, true>()
-		                    : generateLegalMovesT<WHITE, false>();
-	}
-	else {
-		return onlyCaptures ? generateLegalMovesT<BLACK, true>()
-		                    : generateLegalMovesT<BLACK, false>();
-	}
+	MoveList moveList;
+	bool inCheck;
+	moveList.setSize(generateLegalMoves(moveList.buffer(), inCheck, onlyCaptures));
+	moveList.setInCheck(inCheck);
+	return moveList;
+}
+
+size_t MoveGenerator::generateLegalMoves(std::span<Move> moves, bool &inCheck,
+                                         bool onlyCaptures) const {
+	assert(moves.size() >= MAX_MOVES);
+
+	Move *begin = moves.data();
+	Move *end = dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return onlyCaptures ? generateMovesT<UsColor, Backend, true, true>(begin, inCheck)
+		                    : generateMovesT<UsColor, Backend, false, true>(begin, inCheck);
+	});
+	return static_cast<size_t>(end - begin);
+}
+
+size_t MoveGenerator::generatePseudoLegalMoves(std::span<Move> moves, bool &inCheck,
+                                               bool onlyCaptures) const {
+	assert(moves.size() >= MAX_MOVES);
+
+	Move *begin = moves.data();
+	Move *end = dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return onlyCaptures ? generateMovesT<UsColor, Backend, true, false>(begin, inCheck)
+		                    : generateMovesT<UsColor, Backend, false, false>(begin, inCheck);
+	});
+	return static_cast<size_t>(end - begin);
+}
+
+bool MoveGenerator::isLegal(Move move) const {
+	return dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return isLegalT<UsColor, Backend>(move);
+	});
+}
+
+size_t MoveGenerator::generateQuietChecks(std::span<Move> moves, size_t count) const {
+	assert(moves.size() >= MAX_MOVES && count <= MAX_MOVES);
+
+	Move *begin = moves.data();
+	Move *end = dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return generateQuietChecksT<UsColor, Backend>(begin + count);
+	});
+	assert(end <= begin + MAX_MOVES);
+	return static_cast<size_t>(end - begin);
 }
 
-static Bitboard usOcc;
-static Bitboard oppOcc;
-static Bitboard occ;
-static Bitboard oppRooksQueens;
-static Bitboard oppBishopsQueens;
-static int kingSq;
+bool MoveGenerator::givesCheck(Move move) const {
+	return dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return givesCheckT<UsColor, Backend>(move);
+	});
+}
 
-template <int UsColor, bool OnlyCaptures>
-MoveList MoveGenerator::generateLegalMovesT(void) const {
+bool MoveGenerator::isInCheck(void) const {
+	return dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return cachedCheckersT<UsColor, Backend>(makeGenContextT<UsColor>()) != 0;
+	});
+}
+
+size_t MoveGenerator::countLegalMoves(void) const {
+	return dispatchT(position->usColor, [&]<int UsColor, SliderBackend Backend>() {
+		return countLegalMovesT<UsColor, Backend>();
+	});
+}
+
+template <int UsColor>
+MoveGenerator::GenContext MoveGenerator::makeGenContextT(void) const {
 	constexpr int OppColor = UsColor ^ 1;
 
-	MoveList moveList;
+	GenContext ctx;
+	ctx.kingSq = std::countr_zero(P[UsColor * 6 + PT_KING]);
+	assert(ctx.kingSq < 64);
+
+	ctx.usOcc = position->occForColor[UsColor];
+	ctx.oppOcc = position->occForColor[OppColor];
+	ctx.occ = position->occForColor[WHITE] | position->occForColor[BLACK];
+	ctx.oppRooksQueens = P[OppColor * 6 + PT_ROOK] | P[OppColor * 6 + PT_QUEEN];
+	ctx.oppBishopsQueens = P[OppColor * 6 + PT_BISHOP] | P[OppColor * 6 + PT_QUEEN];
+	return ctx;
+}
 
-	// globals used in other functions
+template <int UsColor, SliderBackend Backend, bool OnlyCaptures, bool Legal>
+Move *MoveGenerator::generateMovesT(Move *out, bool &inCheck) const {
+	// state shared with the helper functions
 
-	kingSq = std::countr_zero(P[UsColor * 6 + PT_KING]);
-	assert(kingSq < 64);
+	const GenContext ctx = makeGenContextT<UsColor>();
 
-	usOcc = position->occForColor[UsColor];
-	oppOcc = position->occForColor[OppColor];
-	occ = position->occForColor[WHITE] | position->occForColor[BLACK];
-	oppRooksQueens = P[OppColor * 6 + PT_ROOK] | P[OppColor * 6 + PT_QUEEN];
-	oppBishopsQueens = P[OppColor * 6 + PT_BISHOP] | P[OppColor * 6 + PT_QUEEN];
+	const int kingSq = ctx.kingSq;
+	const Bitboard usOcc = ctx.usOcc;
+	const Bitboard oppOcc = ctx.oppOcc;
+	const Bitboard occ = ctx.occ;
 
 	// locals
 
-	const Bitboard attackMask = computeAttackMaskT<UsColor>();
-	const Bitboard checkerMask = computeCheckerMaskT<UsColor>();
-	const int checkCount = std::popcount(checkerMask);
-	const bool isInCheck = checkCount != 0;
-	moveList.setInCheck(isInCheck);
-	const bool isInDoubleCheck = checkCount > 1;
-	// if in normal check and the checking piece is a slider piece, generate the block mask
-	const Bitboard sliderCheckers =
-	    checkerMask & ~(P[OppColor * 6 + PT_PAWN] | P[OppColor * 6 + PT_KNIGHT]);
-	const Bitboard checkBlockMask = (checkCount == 1 && sliderCheckers)
-	                                    ? BETWEEN_MASK[kingSq][std::countr_zero(sliderCheckers)]
-	                                    : 0ULL;
-	const Bitboard checkEvasionMask = isInCheck ? checkerMask | checkBlockMask : ~0ULL;
-	const Bitboard pinMask = computePinMaskT<UsColor>();
-	const Bitboard capturableSquares = [] {
+	const Bitboard checkerMask = cachedCheckersT<UsColor, Backend>(ctx);
+	inCheck = checkerMask != 0;
+
+	// in check only king moves, captures of the checker & interpositions can be legal;
+	// evasions are always generated fully legal
+	if (inCheck) {
+		return generateEvasionsT<UsColor, Backend, OnlyCaptures>(out, ctx, checkerMask,
+		                                                cachedAttacksT<UsColor, Backend>(ctx));
+	}
+
+	// the pseudo-legal mode skips the attack & pin masks, isLegal() checks the affected moves later
+	const Bitboard attackMask = Legal ? cachedAttacksT<UsColor, Backend>(ctx) : 0ULL;
+	const Bitboard pinMask = Legal ? cachedPinsT<UsColor, Backend>(ctx) : 0ULL;
+	const Bitboard capturableSquares = [&] {
 		if constexpr (OnlyCaptures)
 			return oppOcc;  // only enemy squares
 		else
@@ -86,283 +195,625 @@ MoveList MoveGenerator::generateLegalMovesT(void) const {
 
 	// move generation start
 
-	if (!isInDoubleCheck) [[likely]] {
-		// pawns
-		Bitboard freeSquares = ~occ;
-		Bitboard pawns = P[UsColor * 6 + PT_PAWN];
-
-		while (pawns) {
-			Bitboard currPawn = pawns & -pawns;
-			int currPawnSq = std::countr_zero(currPawn);
-
-			if constexpr (UsColor == WHITE) {
-				// we are white
-				// pushes
-				Bitboard singlePush = [&] {
-					if constexpr (OnlyCaptures)
-						return 0ULL;
-					else
-						return WHITE_PAWN_SINGLE_PUSH_MASK[currPawnSq] & freeSquares;
-				}();
-
-				Bitboard doublePush = [&] {
-					if constexpr (OnlyCaptures)
-						return 0ULL;
-					else
-						return ((singlePush & RANK_3) << 8) & freeSquares;
-				}();
-
-				// captures
-				Bitboard leftCapture = WHITE_PAWN_CAPTURE_LEFT_MASK[currPawnSq] & oppOcc;
-				Bitboard rightCapture = WHITE_PAWN_CAPTURE_RIGHT_MASK[currPawnSq] & oppOcc;
-
-				Bitboard normalMoves = singlePush | doublePush | leftCapture | rightCapture;
-
-				// en-passant
-				Bitboard ep =
-				    isEpLegalT<UsColor>(currPawn)
-				        ? (WHITE_PAWN_CAPTURE_LEFT_MASK[currPawnSq] & position->epSquare) |
-				              (WHITE_PAWN_CAPTURE_RIGHT_MASK[currPawnSq] & position->epSquare)
-				        : 0ULL;
-
-				normalMoves &= checkEvasionMask;
-				if (isInCheck) {
-					// if en-passant does not resolve the check, disallow it
-					if ((ep >> 8) != checkEvasionMask) {
-						ep = 0ULL;
-					}
-				}
+	// pawns
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+	constexpr int UpLeft = UsColor == WHITE ? 7 : -9;
+	constexpr int UpRight = UsColor == WHITE ? 9 : -7;
+	constexpr Bitboard DoublePushRank = UsColor == WHITE ? RANK_3 : RANK_6;
 
-				if (currPawn & pinMask) {
-					normalMoves &= LINE_MASK[currPawnSq][kingSq];
-					ep &= LINE_MASK[currPawnSq][kingSq];
-				}
+	const Bitboard freeSquares = ~occ;
+	const Bitboard pawns = P[UsColor * 6 + PT_PAWN];
 
-				// add en-passant move
-				if (ep) {
-					moveList.push_back(Move(currPawn, ep, PT_PAWN, PT_NULL, false, true));
-				}
+	// unpinned pawns: every push & capture for all of them at once
+	const Bitboard freePawns = pawns & ~pinMask;
 
-				// add each normal move
-				while (normalMoves) {
-					Bitboard to = normalMoves & -normalMoves;
+	if constexpr (!OnlyCaptures) {
+		Bitboard singlePushes = shiftBy<Up>(freePawns) & freeSquares;
+		Bitboard doublePushes = shiftBy<Up>(singlePushes & DoublePushRank) & freeSquares;
 
-					// promotion
-					if (to & RANK_8) {
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_KNIGHT, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_BISHOP, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_ROOK, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_QUEEN, false, false));
-					}
-					else {
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_NULL, false, false));
-					}
+		out = addPawnMovesT<UsColor, Up>(out, singlePushes);
+		out = addPawnMovesT<UsColor, 2 * Up>(out, doublePushes);
+	}
 
-					normalMoves &= normalMoves - 1;
-				}
-			}
-			else {
-				// we are black
-				// pushes
-				Bitboard singlePush = [&] {
-					if constexpr (OnlyCaptures)
-						return 0ULL;
-					else
-						return BLACK_PAWN_SINGLE_PUSH_MASK[currPawnSq] & freeSquares;
-				}();
-
-				Bitboard doublePush = [&] {
-					if constexpr (OnlyCaptures)
-						return 0ULL;
-					else
-						return ((singlePush & RANK_6) >> 8) & freeSquares;
-				}();
-
-				// captures
-				Bitboard leftCapture = BLACK_PAWN_CAPTURE_LEFT_MASK[currPawnSq] & oppOcc;
-				Bitboard rightCapture = BLACK_PAWN_CAPTURE_RIGHT_MASK[currPawnSq] & oppOcc;
-
-				Bitboard normalMoves = singlePush | doublePush | leftCapture | rightCapture;
-
-				// en-passant
-				Bitboard ep =
-				    isEpLegalT<UsColor>(currPawn)
-				        ? (BLACK_PAWN_CAPTURE_LEFT_MASK[currPawnSq] & position->epSquare) |
-				              (BLACK_PAWN_CAPTURE_RIGHT_MASK[currPawnSq] & position->epSquare)
-				        : 0ULL;
-
-				normalMoves &= checkEvasionMask;
-				if (isInCheck) {
-					// if en-passant does not resolve the check, disallow it
-					if ((ep << 8) != checkEvasionMask) {
-						ep = 0ULL;
-					}
-				}
+	Bitboard leftCaptures = shiftBy<UpLeft>(freePawns & ~FILE_A) & oppOcc;
+	Bitboard rightCaptures = shiftBy<UpRight>(freePawns & ~FILE_H) & oppOcc;
 
-				if (currPawn & pinMask) {
-					normalMoves &= LINE_MASK[currPawnSq][kingSq];
-					ep &= LINE_MASK[currPawnSq][kingSq];
-				}
+	out = addPawnMovesT<UsColor, UpLeft>(out, leftCaptures);
+	out = addPawnMovesT<UsColor, UpRight>(out, rightCaptures);
 
-				// add en-passant move
-				if (ep) {
-					moveList.push_back(Move(currPawn, ep, PT_PAWN, PT_NULL, false, true));
-				}
+	// pinned pawns: may only move along the line to our king
+	Bitboard pinnedPawns = pawns & pinMask;
+	while (pinnedPawns) {
+		Bitboard currPawn = pinnedPawns & -pinnedPawns;
+		int currPawnSq = std::countr_zero(currPawn);
 
-				// add each normal move
-				while (normalMoves) {
-					Bitboard to = normalMoves & -normalMoves;
+		Bitboard moves = (shiftBy<UpLeft>(currPawn & ~FILE_A) |
+		                  shiftBy<UpRight>(currPawn & ~FILE_H)) &
+		                 oppOcc;
 
-					// promotion
-					if (to & RANK_1) {
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_KNIGHT, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_BISHOP, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_ROOK, false, false));
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_QUEEN, false, false));
-					}
-					else {
-						moveList.push_back(Move(currPawn, to, PT_PAWN, PT_NULL, false, false));
-					}
+		if constexpr (!OnlyCaptures) {
+			Bitboard singlePush = shiftBy<Up>(currPawn) & freeSquares;
+			moves |= singlePush | (shiftBy<Up>(singlePush & DoublePushRank) & freeSquares);
+		}
 
-					normalMoves &= normalMoves - 1;
-				}
-			}
+		moves &= LINE_MASK[currPawnSq][kingSq];
 
-			pawns &= pawns - 1;
+		while (moves) {
+			Bitboard to = moves & -moves;
+			out = addPawnMoveT<UsColor>(out, currPawn, to);
+			moves &= moves - 1;
 		}
 
-		// knights
-		Bitboard knights = P[UsColor * 6 + PT_KNIGHT];
-		while (knights) {
-			Bitboard currKnight = knights & -knights;
-			int currKnightSq = std::countr_zero(currKnight);
-
-			Bitboard moves = KNIGHT_MOVE_MASK[currKnightSq] & capturableSquares;
+		pinnedPawns &= pinnedPawns - 1;
+	}
 
-			// checks & pins
-			moves &= checkEvasionMask;
+	// en-passant: at most two pawns, look back from the ep square with the enemy capture masks
+	if (position->epSquare) {
+		const int epSq = std::countr_zero(position->epSquare);
+		Bitboard epPawns = [&] {
+			if constexpr (UsColor == WHITE)
+				return (BLACK_PAWN_CAPTURE_LEFT_MASK[epSq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+			else
+				return (WHITE_PAWN_CAPTURE_LEFT_MASK[epSq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+		}();
+
+		while (epPawns) {
+			Bitboard currPawn = epPawns & -epPawns;
+			Bitboard ep =
+			    !Legal || isEpLegalT<UsColor, Backend>(ctx, currPawn) ? position->epSquare : 0ULL;
+
+			if (currPawn & pinMask) {
+				ep &= LINE_MASK[std::countr_zero(currPawn)][kingSq];
+			}
 
-			if (currKnight & pinMask) {
-				moves &= LINE_MASK[currKnightSq][kingSq];
+			if (ep) {
+				*out++ = Move(currPawn, ep, PT_NULL, false, true);
 			}
 
-			addMovesToList(moveList, currKnight, moves, PT_KNIGHT);
-			knights &= knights - 1;
+			epPawns &= epPawns - 1;
 		}
+	}
 
-		// bishops
-		Bitboard bishops = P[UsColor * 6 + PT_BISHOP];
-		while (bishops) {
-			Bitboard currBishop = bishops & -bishops;
-			int currBishopSq = std::countr_zero(currBishop);
-			Bitboard moves = getBishopAttacks(currBishopSq, occ) & capturableSquares;
-
-			// checks & pins
-			moves &= checkEvasionMask;
+	// knights
+	Bitboard knights = P[UsColor * 6 + PT_KNIGHT];
+	while (knights) {
+		Bitboard currKnight = knights & -knights;
+		int currKnightSq = std::countr_zero(currKnight);
 
-			if (currBishop & pinMask) {
-				moves &= LINE_MASK[currBishopSq][kingSq];
-			}
+		Bitboard moves = KNIGHT_MOVE_MASK[currKnightSq] & capturableSquares;
 
-			addMovesToList(moveList, currBishop, moves, PT_BISHOP);
-			bishops &= bishops - 1;
+		// pins
+		if (currKnight & pinMask) {
+			moves &= LINE_MASK[currKnightSq][kingSq];
 		}
 
-		// rooks
-		Bitboard rooks = P[UsColor * 6 + PT_ROOK];
-		while (rooks) {
-			Bitboard currRook = rooks & -rooks;
-			int currRookSq = std::countr_zero(currRook);
-			Bitboard moves = getRookAttacks(currRookSq, occ) & capturableSquares;
+		addMovesToList(out, currKnight, moves);
+		knights &= knights - 1;
+	}
 
-			// checks & pins
-			moves &= checkEvasionMask;
+	// bishops
+	Bitboard bishops = P[UsColor * 6 + PT_BISHOP];
+	while (bishops) {
+		Bitboard currBishop = bishops & -bishops;
+		int currBishopSq = std::countr_zero(currBishop);
+		Bitboard moves = getBishopAttacks<Backend>(currBishopSq, occ) & capturableSquares;
 
-			if (currRook & pinMask) {
-				moves &= LINE_MASK[currRookSq][kingSq];
-			}
-
-			addMovesToList(moveList, currRook, moves, PT_ROOK);
-			rooks &= rooks - 1;
+		// pins
+		if (currBishop & pinMask) {
+			moves &= LINE_MASK[currBishopSq][kingSq];
 		}
 
-		// queens
-		Bitboard queens = P[UsColor * 6 + PT_QUEEN];
-		while (queens) {
-			Bitboard currQueen = queens & -queens;
-			int currQueenSq = std::countr_zero(currQueen);
-			Bitboard moves =
-			    (getRookAttacks(currQueenSq, occ) | getBishopAttacks(currQueenSq, occ)) &
-			    capturableSquares;
+		addMovesToList(out, currBishop, moves);
+		bishops &= bishops - 1;
+	}
 
-			// checks & pins
-			moves &= checkEvasionMask;
+	// rooks
+	Bitboard rooks = P[UsColor * 6 + PT_ROOK];
+	while (rooks) {
+		Bitboard currRook = rooks & -rooks;
+		int currRookSq = std::countr_zero(currRook);
+		Bitboard moves = getRookAttacks<Backend>(currRookSq, occ) & capturableSquares;
 
-			if (currQueen & pinMask) {
-				moves &= LINE_MASK[currQueenSq][kingSq];
-			}
+		// pins
+		if (currRook & pinMask) {
+			moves &= LINE_MASK[currRookSq][kingSq];
+		}
+
+		addMovesToList(out, currRook, moves);
+		rooks &= rooks - 1;
+	}
 
-			addMovesToList(moveList, currQueen, moves, PT_QUEEN);
-			queens &= queens - 1;
+	// queens
+	Bitboard queens = P[UsColor * 6 + PT_QUEEN];
+	while (queens) {
+		Bitboard currQueen = queens & -queens;
+		int currQueenSq = std::countr_zero(currQueen);
+		Bitboard moves =
+		    (getRookAttacks<Backend>(currQueenSq, occ) | getBishopAttacks<Backend>(currQueenSq, occ)) &
+		    capturableSquares;
+
+		// pins
+		if (currQueen & pinMask) {
+			moves &= LINE_MASK[currQueenSq][kingSq];
 		}
+
+		addMovesToList(out, currQueen, moves);
+		queens &= queens - 1;
 	}
 
 	// king
 	Bitboard kingMoves = KING_MOVE_MASK[kingSq] & capturableSquares & ~attackMask;
-	addMovesToList(moveList, P[UsColor * 6 + PT_KING], kingMoves, PT_KING);
+	addMovesToList(out, P[UsColor * 6 + PT_KING], kingMoves);
 
-	// castling generation if not in check
+	// castling generation, we are never in check here
 	if constexpr (!OnlyCaptures) {
-		if (!isInCheck) {
-			if constexpr (UsColor == WHITE) {
-				constexpr Bitboard E1 = 1ULL << 4, F1 = 1ULL << 5, G1 = 1ULL << 6, D1 = 1ULL << 3,
-				                   C1 = 1ULL << 2, B1 = 1ULL << 1;
-				// we are white
-				// king-side
-				if (position->castlingRights & WHITE_KING_SIDE_CASTLE) {
-					Bitboard between = F1 | G1;
-					// squares empty && not attacked
-					if (!(occ & between) && !(attackMask & between)) {
-						moveList.push_back(Move(E1, G1, PT_KING, PT_NULL, true, false));
+		// the squares the king passes must not be attacked
+		auto isPathSafe = [&](Bitboard squares) {
+			if constexpr (Legal) {
+				return !(attackMask & squares);
+			}
+			else {
+				while (squares) {
+					if (isSquareAttackedT<UsColor, Backend>(ctx, std::countr_zero(squares), occ)) {
+						return false;
 					}
+					squares &= squares - 1;
 				}
-				// queen-side
-				if (position->castlingRights & WHITE_QUEEN_SIDE_CASTLE) {
-					Bitboard between = B1 | C1 | D1;
-					Bitboard passSquares = D1 | C1;
-					if (!(occ & between) && !(attackMask & passSquares)) {
-						moveList.push_back(Move(E1, C1, PT_KING, PT_NULL, true, false));
-					}
+				return true;
+			}
+		};
+
+		if constexpr (UsColor == WHITE) {
+			constexpr Bitboard E1 = 1ULL << 4, F1 = 1ULL << 5, G1 = 1ULL << 6, D1 = 1ULL << 3,
+			                   C1 = 1ULL << 2, B1 = 1ULL << 1;
+			// we are white
+			// king-side
+			if (position->castlingRights & WHITE_KING_SIDE_CASTLE) {
+				Bitboard between = F1 | G1;
+				// squares empty && not attacked
+				if (!(occ & between) && isPathSafe(between)) {
+					*out++ = Move(E1, G1, PT_NULL, true, false);
 				}
 			}
-			else {
-				constexpr Bitboard E8 = 1ULL << 60, F8 = 1ULL << 61, G8 = 1ULL << 62,
-				                   D8 = 1ULL << 59, C8 = 1ULL << 58, B8 = 1ULL << 57;
-				// we are black
-				// king-side
-				if (position->castlingRights & BLACK_KING_SIDE_CASTLE) {
-					Bitboard between = F8 | G8;
-					if (!(occ & between) && !(attackMask & between)) {
-						moveList.push_back(Move(E8, G8, PT_KING, PT_NULL, true, false));
-					}
+			// queen-side
+			if (position->castlingRights & WHITE_QUEEN_SIDE_CASTLE) {
+				Bitboard between = B1 | C1 | D1;
+				Bitboard passSquares = D1 | C1;
+				if (!(occ & between) && isPathSafe(passSquares)) {
+					*out++ = Move(E1, C1, PT_NULL, true, false);
 				}
-				// queen-side
-				if (position->castlingRights & BLACK_QUEEN_SIDE_CASTLE) {
-					Bitboard between = B8 | C8 | D8;
-					Bitboard passSquares = D8 | C8;
-					if (!(occ & between) && !(attackMask & passSquares)) {
-						moveList.push_back(Move(E8, C8, PT_KING, PT_NULL, true, false));
-					}
+			}
+		}
+		else {
+			constexpr Bitboard E8 = 1ULL << 60, F8 = 1ULL << 61, G8 = 1ULL << 62,
+			                   D8 = 1ULL << 59, C8 = 1ULL << 58, B8 = 1ULL << 57;
+			// we are black
+			// king-side
+			if (position->castlingRights & BLACK_KING_SIDE_CASTLE) {
+				Bitboard between = F8 | G8;
+				if (!(occ & between) && isPathSafe(between)) {
+					*out++ = Move(E8, G8, PT_NULL, true, false);
+				}
+			}
+			// queen-side
+			if (position->castlingRights & BLACK_QUEEN_SIDE_CASTLE) {
+				Bitboard between = B8 | C8 | D8;
+				Bitboard passSquares = D8 | C8;
+				if (!(occ & between) && isPathSafe(passSquares)) {
+					*out++ = Move(E8, C8, PT_NULL, true, false);
 				}
 			}
 		}
 	}
 
-	return moveList;
+	return out;
 }
 
+template <int UsColor, SliderBackend Backend, bool OnlyCaptures>
+Move *MoveGenerator::generateEvasionsT(Move *out, const GenContext &ctx, Bitboard checkerMask,
+                                       Bitboard attackMask) const {
+	const int kingSq = ctx.kingSq;
+	const Bitboard occ = ctx.occ;
+
+	// king: step out of check or capture the checker
+	const Bitboard capturableSquares = OnlyCaptures ? ctx.oppOcc : ~ctx.usOcc;
+	Bitboard kingMoves = KING_MOVE_MASK[kingSq] & capturableSquares & ~attackMask;
+	addMovesToList(out, P[UsColor * 6 + PT_KING], kingMoves);
+
+	// in double check only the king can move
+	if (!std::has_single_bit(checkerMask)) {
+		return out;
+	}
+
+	// squares between a sliding checker and our king, empty for pawn & knight checks
+	const int checkerSq = std::countr_zero(checkerMask);
+	const Bitboard blockMask = OnlyCaptures ? 0ULL : BETWEEN_MASK[kingSq][checkerSq];
+
+	// a pinned piece can never resolve a check
+	const Bitboard movable = ctx.usOcc & ~cachedPinsT<UsColor, Backend>(ctx);
+
+	// pawns
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+	constexpr int UpLeft = UsColor == WHITE ? 7 : -9;
+	constexpr int UpRight = UsColor == WHITE ? 9 : -7;
+	constexpr Bitboard DoublePushRank = UsColor == WHITE ? RANK_3 : RANK_6;
+
+	const Bitboard pawns = P[UsColor * 6 + PT_PAWN] & movable;
+
+	if constexpr (!OnlyCaptures) {
+		Bitboard singlePushes = shiftBy<Up>(pawns) & ~occ;
+		Bitboard doublePushes = shiftBy<Up>(singlePushes & DoublePushRank) & ~occ;
+
+		out = addPawnMovesT<UsColor, Up>(out, singlePushes & blockMask);
+		out = addPawnMovesT<UsColor, 2 * Up>(out, doublePushes & blockMask);
+	}
+
+	out = addPawnMovesT<UsColor, UpLeft>(out, shiftBy<UpLeft>(pawns & ~FILE_A) & checkerMask);
+	out = addPawnMovesT<UsColor, UpRight>(out, shiftBy<UpRight>(pawns & ~FILE_H) & checkerMask);
+
+	// en-passant only resolves the check if the pawn that just moved is the checker
+	if (position->epSquare && shiftBy<-Up>(position->epSquare) == checkerMask) {
+		const int epSq = std::countr_zero(position->epSquare);
+		Bitboard epPawns = [&] {
+			if constexpr (UsColor == WHITE)
+				return (BLACK_PAWN_CAPTURE_LEFT_MASK[epSq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+			else
+				return (WHITE_PAWN_CAPTURE_LEFT_MASK[epSq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+		}();
+
+		while (epPawns) {
+			Bitboard currPawn = epPawns & -epPawns;
+			if (isEpLegalT<UsColor, Backend>(ctx, currPawn)) {
+				*out++ = Move(currPawn, position->epSquare, PT_NULL, false, true);
+			}
+			epPawns &= epPawns - 1;
+		}
+	}
+
+	// pieces: work backwards from every target square to the pieces that reach it
+	const Bitboard knights = P[UsColor * 6 + PT_KNIGHT] & movable;
+	const Bitboard bishopsQueens = (P[UsColor * 6 + PT_BISHOP] | P[UsColor * 6 + PT_QUEEN]) & movable;
+	const Bitboard rooksQueens = (P[UsColor * 6 + PT_ROOK] | P[UsColor * 6 + PT_QUEEN]) & movable;
+
+	Bitboard targets = checkerMask | blockMask;
+	while (targets) {
+		Bitboard to = targets & -targets;
+		int toSq = std::countr_zero(to);
+
+		Bitboard diagonal = getBishopAttacks<Backend>(toSq, occ);
+		Bitboard orthogonal = getRookAttacks<Backend>(toSq, occ);
+
+		addMovesToSquare(out,
+		                 (KNIGHT_MOVE_MASK[toSq] & knights) | (diagonal & bishopsQueens) |
+		                     (orthogonal & rooksQueens),
+		                 to);
+
+		targets &= targets - 1;
+	}
+
+	return out;
+}
+
+// counts pawn moves onto a set of targets, promotions count four times
 template <int UsColor>
-Bitboard MoveGenerator::computeAttackMaskT(void) const {
+static inline size_t countPawnMovesT(Bitboard targets) {
+	constexpr Bitboard PromoRank = UsColor == WHITE ? RANK_8 : RANK_1;
+	return std::popcount(targets) + 3 * std::popcount(targets & PromoRank);
+}
+
+template <int UsColor, SliderBackend Backend>
+size_t MoveGenerator::countLegalMovesT(void) const {
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+	constexpr int UpLeft = UsColor == WHITE ? 7 : -9;
+	constexpr int UpRight = UsColor == WHITE ? 9 : -7;
+	constexpr Bitboard DoublePushRank = UsColor == WHITE ? RANK_3 : RANK_6;
+
+	const GenContext ctx = makeGenContextT<UsColor>();
+	const int kingSq = ctx.kingSq;
+	const Bitboard occ = ctx.occ;
+
+	const Bitboard checkerMask = cachedCheckersT<UsColor, Backend>(ctx);
+	const Bitboard attackMask = cachedAttacksT<UsColor, Backend>(ctx);
+
+	// king
+	size_t count = std::popcount(KING_MOVE_MASK[kingSq] & ~ctx.usOcc & ~attackMask);
+
+	// in double check only the king can move
+	if (std::popcount(checkerMask) > 1) {
+		return count;
+	}
+
+	// squares the other pieces may move to, in check only captures of the checker & interpositions
+	const Bitboard pinMask = cachedPinsT<UsColor, Backend>(ctx);
+	const Bitboard targetMask =
+	    checkerMask ? checkerMask | BETWEEN_MASK[kingSq][std::countr_zero(checkerMask)] : ~ctx.usOcc;
+	// a pinned piece can never resolve a check
+	const Bitboard movable = checkerMask ? ctx.usOcc & ~pinMask : ctx.usOcc;
+
+	// unpinned pawns
+	const Bitboard pawns = P[UsColor * 6 + PT_PAWN] & movable;
+	const Bitboard freePawns = pawns & ~pinMask;
+	Bitboard singlePushes = shiftBy<Up>(freePawns) & ~occ;
+	Bitboard doublePushes = shiftBy<Up>(singlePushes & DoublePushRank) & ~occ;
+	Bitboard leftCaptures = shiftBy<UpLeft>(freePawns & ~FILE_A) & ctx.oppOcc;
+	Bitboard rightCaptures = shiftBy<UpRight>(freePawns & ~FILE_H) & ctx.oppOcc;
+
+	count += countPawnMovesT<UsColor>(singlePushes & targetMask) +
+	         std::popcount(doublePushes & targetMask) +
+	         countPawnMovesT<UsColor>(leftCaptures & targetMask) +
+	         countPawnMovesT<UsColor>(rightCaptures & targetMask);
+
+	// pinned pawns
+	Bitboard pinnedPawns = pawns & pinMask;
+	while (pinnedPawns) {
+		Bitboard currPawn = pinnedPawns & -pinnedPawns;
+		Bitboard moves =
+		    (shiftBy<UpLeft>(currPawn & ~FILE_A) | shiftBy<UpRight>(currPawn & ~FILE_H)) & ctx.oppOcc;
+		Bitboard singlePush = shiftBy<Up>(currPawn) & ~occ;
+		moves |= singlePush | (shiftBy<Up>(singlePush & DoublePushRank) & ~occ);
+
+		count += countPawnMovesT<UsColor>(moves & LINE_MASK[std::countr_zero(currPawn)][kingSq]);
+		pinnedPawns &= pinnedPawns - 1;
+	}
+
+	// en-passant, in check only if the pawn that just moved is the checker
+	if (position->epSquare && (!checkerMask || shiftBy<-Up>(position->epSquare) == checkerMask)) {
+		const int epSq = std::countr_zero(position->epSquare);
+		Bitboard epPawns = [&] {
+			if constexpr (UsColor == WHITE)
+				return (BLACK_PAWN_CAPTURE_LEFT_MASK[epSq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+			else
+				return (WHITE_PAWN_CAPTURE_LEFT_MASK[epSq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[epSq]) &
+				       pawns;
+		}();
+
+		while (epPawns) {
+			Bitboard currPawn = epPawns & -epPawns;
+			if (isEpLegalT<UsColor, Backend>(ctx, currPawn) &&
+			    (!(currPawn & pinMask) ||
+			     (LINE_MASK[std::countr_zero(currPawn)][kingSq] & position->epSquare))) {
+				count++;
+			}
+			epPawns &= epPawns - 1;
+		}
+	}
+
+	// knights, a pinned knight can never move
+	Bitboard knights = P[UsColor * 6 + PT_KNIGHT] & movable & ~pinMask;
+	while (knights) {
+		count += std::popcount(KNIGHT_MOVE_MASK[std::countr_zero(knights)] & targetMask);
+		knights &= knights - 1;
+	}
+
+	// sliders, pinned ones stay on the line to our king
+	auto countSliderMoves = [&](Bitboard sliders, auto attacksFrom) {
+		while (sliders) {
+			int sliderSq = std::countr_zero(sliders);
+			Bitboard moves = attacksFrom(sliderSq) & targetMask;
+
+			if (sliders & -sliders & pinMask) {
+				moves &= LINE_MASK[sliderSq][kingSq];
+			}
+
+			count += std::popcount(moves);
+			sliders &= sliders - 1;
+		}
+	};
+
+	countSliderMoves(P[UsColor * 6 + PT_BISHOP] & movable,
+	                 [&](int sq) { return getBishopAttacks<Backend>(sq, occ); });
+	countSliderMoves(P[UsColor * 6 + PT_ROOK] & movable,
+	                 [&](int sq) { return getRookAttacks<Backend>(sq, occ); });
+	countSliderMoves(P[UsColor * 6 + PT_QUEEN] & movable, [&](int sq) {
+		return getBishopAttacks<Backend>(sq, occ) | getRookAttacks<Backend>(sq, occ);
+	});
+
+	// castling, never out of check
+	if (!checkerMask) {
+		constexpr int Shift = UsColor == WHITE ? 0 : 56;
+		constexpr Bitboard F = 1ULL << (Shift + 5), G = 1ULL << (Shift + 6), D = 1ULL << (Shift + 3),
+		                   C = 1ULL << (Shift + 2), B = 1ULL << (Shift + 1);
+		constexpr int KingSide = UsColor == WHITE ? WHITE_KING_SIDE_CASTLE : BLACK_KING_SIDE_CASTLE;
+		constexpr int QueenSide = UsColor == WHITE ? WHITE_QUEEN_SIDE_CASTLE : BLACK_QUEEN_SIDE_CASTLE;
+
+		if ((position->castlingRights & KingSide) && !(occ & (F | G)) && !(attackMask & (F | G))) {
+			count++;
+		}
+		if ((position->castlingRights & QueenSide) && !(occ & (B | C | D)) &&
+		    !(attackMask & (C | D))) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+template <int UsColor, SliderBackend Backend>
+Move *MoveGenerator::generateQuietChecksT(Move *out) const {
+	constexpr int OppColor = UsColor ^ 1;
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+	constexpr Bitboard DoublePushRank = UsColor == WHITE ? RANK_3 : RANK_6;
+	constexpr Bitboard PromoRank = UsColor == WHITE ? RANK_8 : RANK_1;
+
+	const int oppKingSq = std::countr_zero(P[OppColor * 6 + PT_KING]);
+	assert(oppKingSq < 64);
+
+	const Bitboard usOcc = position->occForColor[UsColor];
+	const Bitboard occ = position->occForColor[WHITE] | position->occForColor[BLACK];
+	const Bitboard freeSquares = ~occ;
+
+	// our pieces that are the only blocker between one of our sliders & the enemy king;
+	// every move off that line discovers check
+	Bitboard discoverers = 0ULL;
+	Bitboard sliders =
+	    (ROOK_XRAY_MASK[oppKingSq] & (P[UsColor * 6 + PT_ROOK] | P[UsColor * 6 + PT_QUEEN])) |
+	    (BISHOP_XRAY_MASK[oppKingSq] & (P[UsColor * 6 + PT_BISHOP] | P[UsColor * 6 + PT_QUEEN]));
+	while (sliders) {
+		Bitboard between = BETWEEN_MASK[std::countr_zero(sliders)][oppKingSq] & occ;
+		if (std::has_single_bit(between) && (between & usOcc)) {
+			discoverers |= between;
+		}
+		sliders &= sliders - 1;
+	}
+
+	// empty squares from which each piece type gives a direct check
+	const Bitboard pawnChecks = [&] {
+		if constexpr (UsColor == WHITE)
+			return BLACK_PAWN_CAPTURE_LEFT_MASK[oppKingSq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[oppKingSq];
+		else
+			return WHITE_PAWN_CAPTURE_LEFT_MASK[oppKingSq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[oppKingSq];
+	}();
+	const Bitboard knightChecks = KNIGHT_MOVE_MASK[oppKingSq];
+	const Bitboard bishopChecks = getBishopAttacks<Backend>(oppKingSq, occ);
+	const Bitboard rookChecks = getRookAttacks<Backend>(oppKingSq, occ);
+
+	// pawns: pushes onto a checking square, promotions are left to the capture generator
+	const Bitboard pawns = P[UsColor * 6 + PT_PAWN];
+	const Bitboard directPawns = pawns & ~discoverers;
+	Bitboard singlePushes = shiftBy<Up>(directPawns) & freeSquares;
+	Bitboard doublePushes = shiftBy<Up>(singlePushes & DoublePushRank) & freeSquares;
+
+	out = addPawnMovesT<UsColor, Up>(out, singlePushes & pawnChecks & ~PromoRank);
+	out = addPawnMovesT<UsColor, 2 * Up>(out, doublePushes & pawnChecks);
+
+	Bitboard discoveringPawns = pawns & discoverers;
+	while (discoveringPawns) {
+		Bitboard currPawn = discoveringPawns & -discoveringPawns;
+		Bitboard singlePush = shiftBy<Up>(currPawn) & freeSquares & ~PromoRank;
+		Bitboard moves = singlePush | (shiftBy<Up>(singlePush & DoublePushRank) & freeSquares);
+
+		moves &= pawnChecks | ~LINE_MASK[std::countr_zero(currPawn)][oppKingSq];
+		addMovesToList(out, currPawn, moves);
+		discoveringPawns &= discoveringPawns - 1;
+	}
+
+	// pieces: direct checks, or any move off the line for a discoverer
+	auto addPieceChecks = [&](int pt, Bitboard checks, auto attacksFrom) {
+		Bitboard pieces = P[UsColor * 6 + pt];
+		while (pieces) {
+			Bitboard currPiece = pieces & -pieces;
+			int currPieceSq = std::countr_zero(currPiece);
+			Bitboard targets = checks;
+
+			if (currPiece & discoverers) {
+				targets |= ~LINE_MASK[currPieceSq][oppKingSq];
+			}
+
+			addMovesToList(out, currPiece, attacksFrom(currPieceSq) & freeSquares & targets);
+			pieces &= pieces - 1;
+		}
+	};
+
+	addPieceChecks(PT_KNIGHT, knightChecks, [](int sq) { return KNIGHT_MOVE_MASK[sq]; });
+	addPieceChecks(PT_BISHOP, bishopChecks, [&](int sq) { return getBishopAttacks<Backend>(sq, occ); });
+	addPieceChecks(PT_ROOK, rookChecks, [&](int sq) { return getRookAttacks<Backend>(sq, occ); });
+	addPieceChecks(PT_QUEEN, bishopChecks | rookChecks, [&](int sq) {
+		return getBishopAttacks<Backend>(sq, occ) | getRookAttacks<Backend>(sq, occ);
+	});
+
+	// the king can only discover check, castling checks are not generated
+	addPieceChecks(PT_KING, 0ULL, [](int sq) { return KING_MOVE_MASK[sq]; });
+
+	return out;
+}
+
+template <int UsColor, SliderBackend Backend>
+bool MoveGenerator::givesCheckT(Move move) const {
+	constexpr int OppColor = UsColor ^ 1;
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+
+	const Bitboard from = move.getFrom();
+	const Bitboard to = move.getTo();
+	const int oppKingSq = std::countr_zero(P[OppColor * 6 + PT_KING]);
+	const int pt = move.getPromoPt() != PT_NULL ? move.getPromoPt()
+	                                            : position->pieceTypeOn(move.getFromSq(), UsColor);
+
+	// direct checks by pawns & knights
+	if (pt == PT_PAWN) {
+		if constexpr (UsColor == WHITE) {
+			if ((BLACK_PAWN_CAPTURE_LEFT_MASK[oppKingSq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[oppKingSq]) &
+			    to) {
+				return true;
+			}
+		}
+		else {
+			if ((WHITE_PAWN_CAPTURE_LEFT_MASK[oppKingSq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[oppKingSq]) &
+			    to) {
+				return true;
+			}
+		}
+	}
+	else if (pt == PT_KNIGHT && (KNIGHT_MOVE_MASK[oppKingSq] & to)) {
+		return true;
+	}
+
+	// occupancy & sliders after the move, a captured enemy piece does not block anything we care about
+	Bitboard occAfter = ((position->occForColor[WHITE] | position->occForColor[BLACK]) ^ from) | to;
+	Bitboard rooksQueens = (P[UsColor * 6 + PT_ROOK] | P[UsColor * 6 + PT_QUEEN]) & ~from;
+	Bitboard bishopsQueens = (P[UsColor * 6 + PT_BISHOP] | P[UsColor * 6 + PT_QUEEN]) & ~from;
+
+	if (pt == PT_ROOK || pt == PT_QUEEN) {
+		rooksQueens |= to;
+	}
+	if (pt == PT_BISHOP || pt == PT_QUEEN) {
+		bishopsQueens |= to;
+	}
+
+	if (move.getIsEp()) {
+		occAfter ^= shiftBy<-Up>(to);
+	}
+	else if (move.getIsCastling()) {
+		// king-side: the rook jumps from the corner next to the king target to its other side
+		const bool kingSide = to > from;
+		const Bitboard rookFrom = kingSide ? to << 1 : to >> 2;
+		const Bitboard rookTo = kingSide ? to >> 1 : to << 1;
+		occAfter = (occAfter ^ rookFrom) | rookTo;
+		rooksQueens = (rooksQueens & ~rookFrom) | rookTo;
+	}
+
+	// direct slider checks & discovered checks
+	return (getRookAttacks<Backend>(oppKingSq, occAfter) & rooksQueens) ||
+	       (getBishopAttacks<Backend>(oppKingSq, occAfter) & bishopsQueens);
+}
+
+// checkers, pins & the attack map are computed at most once per ply and kept in the StateInfo
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::cachedCheckersT(const GenContext &ctx) const {
+	StateInfo &st = position->stateInfo();
+	if (!(st.cached & STATE_CHECKERS)) {
+		st.checkers = computeCheckerMaskT<UsColor, Backend>(ctx);
+		st.cached |= STATE_CHECKERS;
+	}
+	return st.checkers;
+}
+
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::cachedPinsT(const GenContext &ctx) const {
+	StateInfo &st = position->stateInfo();
+	if (!(st.cached & STATE_PINNED)) {
+		st.pinned = computePinMaskT<UsColor, Backend>(ctx);
+		st.cached |= STATE_PINNED;
+	}
+	return st.pinned;
+}
+
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::cachedAttacksT(const GenContext &ctx) const {
+	StateInfo &st = position->stateInfo();
+	if (!(st.cached & STATE_ATTACKED)) {
+		st.attacked = computeAttackMaskT<UsColor, Backend>(ctx);
+		st.cached |= STATE_ATTACKED;
+	}
+	return st.attacked;
+}
+
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::computeAttackMaskT(const GenContext &ctx) const {
 	constexpr int OppColor = UsColor ^ 1;
 
 	Bitboard attackMask = 0ULL;
@@ -377,21 +828,10 @@ Bitboard MoveGenerator::computeAttackMaskT(void) const {
 		attackMask |= ((P[PT_PAWN] & ~FILE_H) << 9) | ((P[PT_PAWN] & ~FILE_A) << 7);
 	}
 
-	Bitboard occWithoutKing = occ & ~P[UsColor * 6 + PT_KING];
-
-	// rooks & queens
-	Bitboard localOppRooksQueens = oppRooksQueens;
-	while (localOppRooksQueens) {
-		attackMask |= getRookAttacks(std::countr_zero(localOppRooksQueens), occWithoutKing);
-		localOppRooksQueens &= localOppRooksQueens - 1;
-	}
+	Bitboard occWithoutKing = ctx.occ & ~P[UsColor * 6 + PT_KING];
 
-	// bishops & queens
-	Bitboard localOppBishopsQueens = oppBishopsQueens;
-	while (localOppBishopsQueens) {
-		attackMask |= getBishopAttacks(std::countr_zero(localOppBishopsQueens), occWithoutKing);
-		localOppBishopsQueens &= localOppBishopsQueens - 1;
-	}
+	// rooks, bishops & queens
+	attackMask |= getSliderAttackMap(ctx.oppRooksQueens, ctx.oppBishopsQueens, occWithoutKing);
 
 	// knights
 	Bitboard oppKnights = P[OppColor * 6 + PT_KNIGHT];
@@ -408,9 +848,10 @@ Bitboard MoveGenerator::computeAttackMaskT(void) const {
 	return attackMask;
 }
 
-template <int UsColor>
-Bitboard MoveGenerator::computeCheckerMaskT(void) const {
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::computeCheckerMaskT(const GenContext &ctx) const {
 	constexpr int OppColor = UsColor ^ 1;
+	const int kingSq = ctx.kingSq;
 
 	Bitboard checkerMask = 0ULL;
 
@@ -431,10 +872,10 @@ Bitboard MoveGenerator::computeCheckerMaskT(void) const {
 	}
 
 	// rooks & queens
-	checkerMask |= getRookAttacks(kingSq, occ) & oppRooksQueens;
+	checkerMask |= getRookAttacks<Backend>(kingSq, ctx.occ) & ctx.oppRooksQueens;
 
 	// bishops & queens
-	checkerMask |= getBishopAttacks(kingSq, occ) & oppBishopsQueens;
+	checkerMask |= getBishopAttacks<Backend>(kingSq, ctx.occ) & ctx.oppBishopsQueens;
 
 	// knights
 	checkerMask |= KNIGHT_MOVE_MASK[kingSq] & P[OppColor * 6 + PT_KNIGHT];
@@ -442,19 +883,20 @@ Bitboard MoveGenerator::computeCheckerMaskT(void) const {
 	return checkerMask;
 }
 
-template <int UsColor>
-Bitboard MoveGenerator::computePinMaskT(void) const {
-	Bitboard potentialPinners =
-	    (ROOK_XRAY_MASK[kingSq] & oppRooksQueens) | (BISHOP_XRAY_MASK[kingSq] & oppBishopsQueens);
+template <int UsColor, SliderBackend Backend>
+Bitboard MoveGenerator::computePinMaskT(const GenContext &ctx) const {
+	const int kingSq = ctx.kingSq;
+	Bitboard potentialPinners = (ROOK_XRAY_MASK[kingSq] & ctx.oppRooksQueens) |
+	                            (BISHOP_XRAY_MASK[kingSq] & ctx.oppBishopsQueens);
 
 	Bitboard pinMask = 0ULL;
 
 	while (potentialPinners) {
 		int pinnerSq = std::countr_zero(potentialPinners);
-		Bitboard between = BETWEEN_MASK[pinnerSq][kingSq] & occ;
+		Bitboard between = BETWEEN_MASK[pinnerSq][kingSq] & ctx.occ;
 
 		// if there is exactly one piece in between and it is friendly
-		if (std::has_single_bit(between) && (between & usOcc)) {
+		if (std::has_single_bit(between) && (between & ctx.usOcc)) {
 			pinMask |= between;
 		}
 
@@ -464,9 +906,73 @@ Bitboard MoveGenerator::computePinMaskT(void) const {
 	return pinMask;
 }
 
-template <int UsColor>
-bool MoveGenerator::isEpLegalT(Bitboard capturingPawn) const {
-	// this function only does a quick horizontal check, which is not covered by pin detection
+template <int UsColor, SliderBackend Backend>
+bool MoveGenerator::isSquareAttackedT(const GenContext &ctx, int sq, Bitboard occ) const {
+	constexpr int OppColor = UsColor ^ 1;
+
+	// pawns, looking from the attacked square with our own pawn capture masks
+	Bitboard pawnAttackers = [&] {
+		if constexpr (UsColor == WHITE)
+			return (WHITE_PAWN_CAPTURE_LEFT_MASK[sq] | WHITE_PAWN_CAPTURE_RIGHT_MASK[sq]) &
+			       P[PT_PAWN + 6];
+		else
+			return (BLACK_PAWN_CAPTURE_LEFT_MASK[sq] | BLACK_PAWN_CAPTURE_RIGHT_MASK[sq]) &
+			       P[PT_PAWN];
+	}();
+
+	return pawnAttackers || (KNIGHT_MOVE_MASK[sq] & P[OppColor * 6 + PT_KNIGHT]) ||
+	       (KING_MOVE_MASK[sq] & P[OppColor * 6 + PT_KING]) ||
+	       (getRookAttacks<Backend>(sq, occ) & ctx.oppRooksQueens) ||
+	       (getBishopAttacks<Backend>(sq, occ) & ctx.oppBishopsQueens);
+}
+
+template <int UsColor, SliderBackend Backend>
+bool MoveGenerator::isLegalT(Move move) const {
+	constexpr int OppColor = UsColor ^ 1;
+	constexpr int Up = UsColor == WHITE ? 8 : -8;
+
+	// castling is fully checked during generation
+	if (move.getIsCastling()) {
+		return true;
+	}
+
+	const Bitboard from = move.getFrom();
+	const Bitboard to = move.getTo();
+	const Bitboard king = P[UsColor * 6 + PT_KING];
+	const int kingSq = std::countr_zero(king);
+
+	// a captured slider no longer gives check
+	GenContext ctx;
+	ctx.occ = position->occForColor[WHITE] | position->occForColor[BLACK];
+	ctx.oppRooksQueens = (P[OppColor * 6 + PT_ROOK] | P[OppColor * 6 + PT_QUEEN]) & ~to;
+	ctx.oppBishopsQueens = (P[OppColor * 6 + PT_BISHOP] | P[OppColor * 6 + PT_QUEEN]) & ~to;
+
+	// king: the target must not be attacked once the king has left its square
+	if (from == king) {
+		return !isSquareAttackedT<UsColor, Backend>(ctx, std::countr_zero(to), ctx.occ ^ king);
+	}
+
+	Bitboard occAfter = (ctx.occ ^ from) | to;
+	if (move.getIsEp()) {
+		// both pawns leave the capture rank, so run the full slider test
+		occAfter ^= shiftBy<-Up>(to);
+	}
+	else {
+		// only a piece on a line with our king can be pinned, and it may move along that line
+		if (!((ROOK_XRAY_MASK[kingSq] | BISHOP_XRAY_MASK[kingSq]) & from) ||
+		    (LINE_MASK[std::countr_zero(from)][kingSq] & to)) {
+			return true;
+		}
+	}
+
+	return !(getRookAttacks<Backend>(kingSq, occAfter) & ctx.oppRooksQueens) &&
+	       !(getBishopAttacks<Backend>(kingSq, occAfter) & ctx.oppBishopsQueens);
+}
+
+template <int UsColor, SliderBackend Backend>
+bool MoveGenerator::isEpLegalT(const GenContext &ctx, Bitboard capturingPawn) const {
+	// both pawns leave their squares, which pin detection does not cover: the capture can expose
+	// the king on the rank, or on a diagonal through the captured pawn
 
 	// no en-passant
 	if (!position->epSquare) {
@@ -481,27 +987,14 @@ bool MoveGenerator::isEpLegalT(Bitboard capturingPawn) const {
 		capturedPawn = position->epSquare << 8;
 	}
 
-	int epRank = std::countr_zero(capturedPawn) >> 3;
-	int kingRank = kingSq >> 3;
-
-	if (epRank != kingRank) {
+	// no enemy slider on a line with our king
+	if (!(ROOK_XRAY_MASK[ctx.kingSq] & ctx.oppRooksQueens) &&
+	    !(BISHOP_XRAY_MASK[ctx.kingSq] & ctx.oppBishopsQueens)) {
 		return true;
 	}
 
-	// occupancy without both pawns
-	Bitboard occWithoutPawns = occ & ~capturingPawn & ~capturedPawn;
-	Bitboard relevantAttackers =
-	    (RANK_1 << (8 * epRank)) &
-	    oppRooksQueens;  // attackers are only relevant if they can check horizontally
-
-	while (relevantAttackers) {
-		int attackerSq = std::countr_zero(relevantAttackers);
-		// if there is nothing between the attacker and king
-		if (!(occWithoutPawns & BETWEEN_MASK[kingSq][attackerSq])) {
-			return false;
-		}
-		relevantAttackers &= relevantAttackers - 1;
-	}
-
-	return true;
+	// same slider test as isLegalT, on the occupancy after the capture
+	Bitboard occAfter = (ctx.occ ^ capturingPawn ^ capturedPawn) | position->epSquare;
+	return !(getRookAttacks<Backend>(ctx.kingSq, occAfter) & ctx.oppRooksQueens) &&
+	       !(getBishopAttacks<Backend>(ctx.kingSq, occAfter) & ctx.oppBishopsQueens);
 }
@@ -1,6 +1,10 @@
 #ifndef MOVEGEN_HPP
 #define MOVEGEN_HPP
 
+#include <cstddef>
+#include <span>
+
+#include "bitboards.hpp"
 #include "movelist.hpp"
 #include "position.hpp"
 
@@ -10,19 +14,69 @@ class MoveGenerator {
 	explicit MoveGenerator(Position* positionPtr);
 
 	MoveList generateLegalMoves(bool onlyCaptures = false) const;
+	// writes legal moves into a caller-owned buffer of at least MAX_MOVES and returns the count
+	size_t generateLegalMoves(std::span<Move> moves, bool &inCheck,
+	                          bool onlyCaptures = false) const;
+	// like generateLegalMoves, but pinned-piece, king & en-passant moves are left unchecked unless
+	// in check; every move must pass isLegal() before it is made
+	size_t generatePseudoLegalMoves(std::span<Move> moves, bool &inCheck,
+	                                bool onlyCaptures = false) const;
+	// legality of a move from generatePseudoLegalMoves in a position that is not in check
+	bool isLegal(Move move) const;
+	// appends the pseudo-legal non-capture, non-promotion moves that give check after the first
+	// count moves (the captures) & returns the new count, when not in check; they never overlap
+	// the captures, so both fit into one MAX_MOVES buffer
+	size_t generateQuietChecks(std::span<Move> moves, size_t count) const;
+	// whether a move gives check, without making it
+	bool givesCheck(Move move) const;
+	// whether the side to move is in check, cached per ply like the generator's other masks
+	bool isInCheck(void) const;
+	// number of legal moves, counted over target bitboards without writing any moves
+	size_t countLegalMoves(void) const;
 
    private:
-	// color-specific templates
-	template <int UsColor, bool OnlyCaptures>
-	MoveList generateLegalMovesT(void) const;
-	template <int UsColor>
-	Bitboard computeAttackMaskT(void) const;
-	template <int UsColor>
-	Bitboard computeCheckerMaskT(void) const;
-	template <int UsColor>
-	Bitboard computePinMaskT(void) const;
+	// occupancy & king data computed once per generation call and shared with the helpers
+	struct GenContext {
+		Bitboard usOcc;
+		Bitboard oppOcc;
+		Bitboard occ;
+		Bitboard oppRooksQueens;
+		Bitboard oppBishopsQueens;
+		int kingSq;
+	};
+
+	// templates per color & slider backend, the hot ones are multiversioned in portable builds
 	template <int UsColor>
-	bool isEpLegalT(Bitboard capturingPawn) const;
+	GenContext makeGenContextT(void) const;
+	template <int UsColor, SliderBackend Backend, bool OnlyCaptures, bool Legal>
+	MULTIVERSION Move *generateMovesT(Move *out, bool &inCheck) const;
+	template <int UsColor, SliderBackend Backend, bool OnlyCaptures>
+	MULTIVERSION Move *generateEvasionsT(Move *out, const GenContext &ctx, Bitboard checkerMask,
+	                                     Bitboard attackMask) const;
+	template <int UsColor, SliderBackend Backend>
+	MULTIVERSION size_t countLegalMovesT(void) const;
+	template <int UsColor, SliderBackend Backend>
+	MULTIVERSION Move *generateQuietChecksT(Move *out) const;
+	template <int UsColor, SliderBackend Backend>
+	MULTIVERSION bool givesCheckT(Move move) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard cachedCheckersT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard cachedPinsT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard cachedAttacksT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard computeAttackMaskT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard computeCheckerMaskT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	Bitboard computePinMaskT(const GenContext &ctx) const;
+	template <int UsColor, SliderBackend Backend>
+	bool isSquareAttackedT(const GenContext &ctx, int sq, Bitboard occ) const;
+	template <int UsColor, SliderBackend Backend>
+	MULTIVERSION bool isLegalT(Move move) const;
+	template <int UsColor, SliderBackend Backend>
+	bool isEpLegalT(const GenContext &ctx, Bitboard capturingPawn) const;
 
 	Position* position = nullptr;
 	Bitboard* P = nullptr;  // alias for position->pieces
@@ -2,6 +2,7 @@
 #define MOVELIST_HPP
 
 #include <cstddef>
+#include <span>
 
 #include "misc.hpp"
 #include "move.hpp"
@@ -21,6 +22,10 @@ class MoveList {
 	// modifiers
 	inline void push_back(Move move) noexcept { moves[count++] = move; }
 	inline void setInCheck(bool val) noexcept { isInCheck = val; }
+	inline void setSize(size_t size) noexcept { count = size; }
+
+	// raw storage for generators that write moves directly
+	inline std::span<Move> buffer(void) noexcept { return moves; }
 
 	// accessors
 	inline bool inCheck(void) const noexcept { return isInCheck; }
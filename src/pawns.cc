@@ -0,0 +1,141 @@
+#include "pawns.hpp"
+
+#include <array>
+#include <bit>
+
+#include "bitboards.hpp"
+
+static constexpr Score DOUBLED_MG = -10;
+static constexpr Score DOUBLED_EG = -20;
+static constexpr Score ISOLATED_MG = -10;
+static constexpr Score ISOLATED_EG = -15;
+static constexpr Score BACKWARD_MG = -8;
+static constexpr Score BACKWARD_EG = -10;
+static constexpr Score SHIELD_MG = 8;
+
+// passed pawn bonus by rank relative to the pawn's color
+static constexpr Score PASSED_MG[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+static constexpr Score PASSED_EG[8] = {0, 10, 20, 35, 60, 100, 150, 0};
+
+// files next to the given file
+static constexpr std::array<Bitboard, 8> ADJACENT_FILES = [] {
+	std::array<Bitboard, 8> masks{};
+	for (int file = 0; file < 8; file++) {
+		masks[file] = (file > 0 ? FILE_A << (file - 1) : 0) | (file < 7 ? FILE_A << (file + 1) : 0);
+	}
+	return masks;
+}();
+
+// ranks strictly in front of a rank, seen from the given color
+static constexpr std::array<std::array<Bitboard, 8>, 2> FORWARD_RANKS = [] {
+	std::array<std::array<Bitboard, 8>, 2> masks{};
+	for (int rank = 0; rank < 8; rank++) {
+		masks[WHITE][rank] = rank < 7 ? ~0ULL << (8 * (rank + 1)) : 0;
+		masks[BLACK][rank] = (1ULL << (8 * rank)) - 1;
+	}
+	return masks;
+}();
+
+// the three files around the king, one & two ranks in front of it
+static constexpr std::array<std::array<Bitboard, 64>, 2> SHIELD_MASK = [] {
+	std::array<std::array<Bitboard, 64>, 2> masks{};
+	for (int sq = 0; sq < 64; sq++) {
+		const int file = sq & 7;
+		const int rank = sq >> 3;
+		const Bitboard files = (FILE_A << file) | ADJACENT_FILES[file];
+		for (int color = 0; color < 2; color++) {
+			const int dir = color == WHITE ? 1 : -1;
+			for (int step = 1; step <= 2; step++) {
+				const int shieldRank = rank + dir * step;
+				if (shieldRank >= 0 && shieldRank < 8) {
+					masks[color][sq] |= files & (RANK_1 << (8 * shieldRank));
+				}
+			}
+		}
+	}
+	return masks;
+}();
+
+template <int Color>
+static inline Bitboard pawnAttacks(Bitboard pawns) {
+	if constexpr (Color == WHITE) {
+		return ((pawns << 7) & ~FILE_H) | ((pawns << 9) & ~FILE_A);
+	}
+	else {
+		return ((pawns >> 9) & ~FILE_H) | ((pawns >> 7) & ~FILE_A);
+	}
+}
+
+// doubled, isolated, backward & passed pawns of one color, added to entry from its point of view
+template <int Color>
+static void evaluatePawnsT(const Position &pos, PawnEntry &entry) {
+	constexpr int Opp = Color ^ 1;
+	constexpr int sign = Color == WHITE ? 1 : -1;
+
+	const Bitboard ours = pos.pieces[Color * 6 + PT_PAWN];
+	const Bitboard theirs = pos.pieces[Opp * 6 + PT_PAWN];
+	const Bitboard theirAttacks = pawnAttacks<Opp>(theirs);
+
+	Score mg = 0, eg = 0;
+	Bitboard passed = 0;
+
+	for (Bitboard b = ours; b; b &= b - 1) {
+		const int sq = std::countr_zero(b);
+		const int file = sq & 7;
+		const int rank = sq >> 3;
+		const int relativeRank = Color == WHITE ? rank : 7 - rank;
+		const Bitboard fileMask = FILE_A << file;
+		const Bitboard adjacent = ADJACENT_FILES[file];
+		const Bitboard front = FORWARD_RANKS[Color][rank];
+
+		// the rear pawn of a doubled pair takes the penalty
+		if (ours & fileMask & front) {
+			mg += DOUBLED_MG;
+			eg += DOUBLED_EG;
+		}
+
+		if (!(ours & adjacent)) {
+			mg += ISOLATED_MG;
+			eg += ISOLATED_EG;
+		}
+		// no neighbour level or behind that could support its advance, & the stop square is guarded
+		else if (!(ours & adjacent & ~front)) {
+			const Bitboard stop = Color == WHITE ? 1ULL << (sq + 8) : 1ULL << (sq - 8);
+			if (stop & theirAttacks) {
+				mg += BACKWARD_MG;
+				eg += BACKWARD_EG;
+			}
+		}
+
+		if (!(theirs & (fileMask | adjacent) & front)) {
+			passed |= 1ULL << sq;
+			mg += PASSED_MG[relativeRank];
+			eg += PASSED_EG[relativeRank];
+		}
+	}
+
+	entry.passed[Color] = passed;
+	entry.mg += sign * mg;
+	entry.eg += sign * eg;
+}
+
+const PawnEntry &PawnTable::probe(const Position &position) {
+	PawnEntry &entry = entries[position.pawnKey & (ENTRIES - 1)];
+	if (entry.key == position.pawnKey) {
+		return entry;
+	}
+
+	entry.key = position.pawnKey;
+	entry.mg = entry.eg = 0;
+	evaluatePawnsT<WHITE>(position, entry);
+	evaluatePawnsT<BLACK>(position, entry);
+	return entry;
+}
+
+Score pawnShieldScore(const Position &position) {
+	const int whiteKing = std::countr_zero(position.pieces[WHITE * 6 + PT_KING]);
+	const int blackKing = std::countr_zero(position.pieces[BLACK * 6 + PT_KING]);
+	const int white = std::popcount(position.pieces[WHITE * 6 + PT_PAWN] & SHIELD_MASK[WHITE][whiteKing]);
+	const int black = std::popcount(position.pieces[BLACK * 6 + PT_PAWN] & SHIELD_MASK[BLACK][blackKing]);
+	return (white - black) * SHIELD_MG;
+}
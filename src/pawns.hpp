@@ -0,0 +1,35 @@
+#ifndef PAWNS_HPP
+#define PAWNS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "misc.hpp"
+#include "position.hpp"
+
+// pawn structure evaluation of one pawn configuration, white positive
+struct PawnEntry {
+	uint64_t key;        // pawn key of the configuration
+	Bitboard passed[2];  // passed pawns of each color
+	Score mg;
+	Score eg;
+};
+
+// per-thread cache of pawn structure evaluations, indexed by the pawn key
+class PawnTable {
+   public:
+	const PawnEntry &probe(const Position &position);  // evaluates the pawns on a miss
+
+   private:
+	static constexpr size_t ENTRIES = 1 << 14;  // 512 KiB
+
+	// zeroed entries are valid: key 0 is the position without pawns, which scores 0
+	std::vector<PawnEntry> entries = std::vector<PawnEntry>(ENTRIES);
+};
+
+// own pawns sheltering the king, white positive & midgame only. Depends on the king square, so it
+// is not cached
+Score pawnShieldScore(const Position &position);
+
+#endif  // PAWNS_HPP
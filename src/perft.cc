@@ -1,26 +1,36 @@
 #include "perft.hpp"
 
+#include <cassert>
 #include <iostream>
+#include <vector>
 
 #include "movegen.hpp"
 #include "movelist.hpp"
 
-static Position position;
-static MoveGenerator moveGenerator = MoveGenerator(&position);
-
+// moves is the buffer for this ply, deeper plies use the following MAX_MOVES slots
 template <bool PrintPerftLine>
-static size_t perftT(int depth) {
-	size_t nodes = 0;
-
-	MoveList legalMoves = moveGenerator.generateLegalMoves();
-
+static size_t perftT(Position &position, const MoveGenerator &moveGenerator, Move *moves,
+                     int depth) {
+	// leaves only need the number of moves
 	if (depth == 1) {
-		return static_cast<size_t>(legalMoves.size());
+		return moveGenerator.countLegalMoves();
 	}
 
-	for (Move move : legalMoves) {
+	size_t nodes = 0;
+
+	bool inCheck;
+	const size_t moveCount =
+	    moveGenerator.generateLegalMoves(std::span<Move>(moves, MAX_MOVES), inCheck);
+
+	for (size_t i = 0; i < moveCount; i++) {
+		const Move move = moves[i];
+#ifndef NDEBUG
+		// debug builds cross-check givesCheck against the position after the move
+		const bool givesCheck = moveGenerator.givesCheck(move);
+#endif
 		position.makeMove(move);
-		size_t count = perftT<false>(depth - 1);
+		assert(givesCheck == moveGenerator.isInCheck());
+		size_t count = perftT<false>(position, moveGenerator, moves + MAX_MOVES, depth - 1);
 
 		if constexpr (PrintPerftLine) {
 			std::cout << move.toLan() << ": " << count << '\n';
@@ -35,9 +45,18 @@ static size_t perftT(int depth) {
 
 // wrapper for perft
 size_t perft(const Position &pos, int depth, bool printPerftLine) {
-	position = pos;
+	if (depth < 1) {
+		return 1;
+	}
+
+	// every call works on its own copy & stacks, so perft can run on several threads at once
+	PositionHistory history;
+	Position position = pos;
+	position.setHistory(&history);
+	const MoveGenerator moveGenerator(&position);
+	std::vector<Move> moveBuffer(static_cast<size_t>(depth) * MAX_MOVES);
 	if (printPerftLine) {
-		return perftT<true>(depth);
+		return perftT<true>(position, moveGenerator, moveBuffer.data(), depth);
 	}
-	return perftT<false>(depth);
+	return perftT<false>(position, moveGenerator, moveBuffer.data(), depth);
 }
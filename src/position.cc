@@ -1,22 +1,22 @@
 #include "position.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <charconv>
 #include <cctype>
-#include <sstream>
 #include <string>
-#include <unordered_map>
 
 #include "bitboards.hpp"
+#include "eval.hpp"
 #include "misc.hpp"
 #include "zobrist.hpp"
 
-Position::Position(void)
-    : occForColor{},
-      epSquare(0),
-      rule50(0),
-      castlingRights(0b1111),
-      usColor(WHITE),
-      oppColor(BLACK) {
+Position::Position(void) : BoardState{} {
+	castlingRights = 0b1111;
+	usColor = WHITE;
+	oppColor = BLACK;
+
 	pieces[PT_PAWN] = 0x000000000000FF00ULL;
 	pieces[PT_KNIGHT] = 0x0000000000000042ULL;
 	pieces[PT_BISHOP] = 0x0000000000000024ULL;
@@ -36,148 +36,165 @@ Position::Position(void)
 		}
 	}
 
+	computeBoard();
+	computeEvalSums();
 	hash = computeHash();
-	hashHistory.clear();
-	saveHash();
+	pawnKey = computePawnKey();
 }
 
-Position Position::fromFen(const std::string &fen, bool &success) noexcept {
-	success = false;
+// piece index of a FEN piece character, -1 for anything else
+static constexpr std::array<int8_t, 256> FEN_PIECES = [] {
+	std::array<int8_t, 256> table{};
+	table.fill(-1);
+	const char *chars = "PNBRQKpnbrqk";
+	for (int8_t idx = 0; idx < 12; idx++) {
+		table[static_cast<unsigned char>(chars[idx])] = idx;
+	}
+	return table;
+}();
+
+// puts a piece on an empty square while a position is being built, returns its zobrist key
+static inline uint64_t placePiece(BoardState &state, int pieceIdx, int sq) noexcept {
+	state.pieces[pieceIdx] |= 1ULL << sq;
+	state.board[sq] = static_cast<uint8_t>(pieceIdx);
+	state.psqMg += PSQ_MG[pieceIdx][sq];
+	state.psqEg += PSQ_EG[pieceIdx][sq];
+	state.phase += PHASE_WEIGHT[pieceIdx % 6];
+	if (pieceIdx % 6 == PT_PAWN) state.pawnKey ^= Z_PSQ[pieceIdx][sq];
+	state.materialKey += materialUnit(pieceIdx);
+	return Z_PSQ[pieceIdx][sq];
+}
 
-	Position pos;
+// occupancy & hash of a position built with placePiece
+static inline void finishPlacement(BoardState &state, uint64_t pieceHash) noexcept {
+	for (int pieceIdx = 0; pieceIdx < 12; pieceIdx++) {
+		state.occForColor[pieceIdx / 6] |= state.pieces[pieceIdx];
+	}
+	state.hash = pieceHash;
+}
 
-	// reset to empty
-	for (int i = 0; i < 12; i++) pos.pieces[i] = 0ULL;
-	pos.occForColor[0] = pos.occForColor[1] = 0ULL;
-	pos.epSquare = 0ULL;
-	pos.rule50 = 0;
-	pos.castlingRights = 0;
+static constexpr char PIECE_CHARS[12] = {'P', 'N', 'B', 'R', 'Q', 'K', 'p', 'n', 'b', 'r', 'q', 'k'};
+
+// next whitespace separated field, empty at the end of the string
+static std::string_view nextField(std::string_view str, size_t &pos) noexcept {
+	while (pos < str.size() && (str[pos] == ' ' || str[pos] == '\t')) pos++;
+	const size_t start = pos;
+	while (pos < str.size() && str[pos] != ' ' && str[pos] != '\t') pos++;
+	return str.substr(start, pos - start);
+}
+
+Position Position::fromFen(std::string_view fen, bool &success) noexcept {
+	success = false;
+
+	Position pos{BoardState{}};
+	std::fill(std::begin(pos.board), std::end(pos.board), NO_PIECE);
 	pos.usColor = WHITE;
 	pos.oppColor = BLACK;
 
-	try {
-		std::istringstream stream(fen);
+	size_t cursor = 0;
+	const std::string_view piecePlacement = nextField(fen, cursor);
+	const std::string_view activeColorStr = nextField(fen, cursor);
+	const std::string_view castlingRightsStr = nextField(fen, cursor);
+	const std::string_view epSqStr = nextField(fen, cursor);
 
-		std::string piecePlacement;
-		std::string activeColorStr;
-		std::string castlingRightsStr;
-		std::string epSqStr;
-		std::string rule50Str;
-		std::string fullMoveStr;
-
-		if (!(stream >> piecePlacement >> activeColorStr >> castlingRightsStr >> epSqStr >>
-		      rule50Str >> fullMoveStr)) {
-			return pos;  // missing fields
-		}
+	if (epSqStr.empty()) {
+		return pos;  // missing fields
+	}
 
-		int rank = 7;
-		int file = 0;
+	int rank = 7;
+	int file = 0;
+	uint64_t pieceHash = 0;
 
-		static const std::unordered_map<char, int> charToPieceIdx = {
-		    {'P', PT_PAWN},       {'N', PT_KNIGHT},   {'B', PT_BISHOP},    {'R', PT_ROOK},
-		    {'Q', PT_QUEEN},      {'K', PT_KING},     {'p', PT_PAWN + 6},  {'n', PT_KNIGHT + 6},
-		    {'b', PT_BISHOP + 6}, {'r', PT_ROOK + 6}, {'q', PT_QUEEN + 6}, {'k', PT_KING + 6}};
+	for (char c : piecePlacement) {
+		if (c >= '1' && c <= '8') {
+			file += c - '0';
+			if (file > 8) return pos;  // too many squares in a rank
+			continue;
+		}
+		if (c == '/') {
+			if (file != 8) return pos;  // rank incomplete
+			rank--;
+			if (rank < 0) return pos;  // too many ranks
+			file = 0;
+			continue;
+		}
 
-		for (char c : piecePlacement) {
-			if (std::isdigit(static_cast<unsigned char>(c))) {
-				file += c - '0';
-				if (file > 8) return pos;  // too many squares in a rank
-				continue;
-			}
-			if (c == '/') {
-				if (file != 8) return pos;  // rank incomplete
-				rank--;
-				if (rank < 0) return pos;  // too many ranks
-				file = 0;
-				continue;
-			}
+		if (file > 7) return pos;
 
-			if (rank < 0 || rank > 7 || file < 0 || file > 7) return pos;
+		const int pieceIdx = FEN_PIECES[static_cast<unsigned char>(c)];
+		if (pieceIdx < 0) return pos;  // invalid piece char
 
-			auto it = charToPieceIdx.find(c);
-			if (it == charToPieceIdx.end()) return pos;  // invalid piece char
+		pieceHash ^= placePiece(pos, pieceIdx, rank * 8 + file);
+		file++;
+	}
 
-			pos.pieces[it->second] |= (1ULL << (rank * 8 + file));
-			file++;
-		}
+	if (rank != 0 || file != 8) return pos;
+	finishPlacement(pos, pieceHash);
 
-		if (rank != 0 || file != 8) return pos;
+	if (activeColorStr == "w") {
+		pos.usColor = WHITE;
+		pos.oppColor = BLACK;
+	}
+	else if (activeColorStr == "b") {
+		pos.usColor = BLACK;
+		pos.oppColor = WHITE;
+	}
+	else {
+		return pos;
+	}
 
-		// occupancy
-		pos.occForColor[0] = 0;
-		pos.occForColor[1] = 0;
-		for (int color = 0; color < 2; color++) {
-			for (int pt = 0; pt < 6; pt++) {
-				pos.occForColor[color] |= pos.pieces[color * 6 + pt];
+	pos.castlingRights = 0;
+	if (castlingRightsStr != "-") {
+		for (char c : castlingRightsStr) {
+			switch (c) {
+				case 'K':
+					pos.castlingRights |= WHITE_KING_SIDE_CASTLE;
+					break;
+				case 'Q':
+					pos.castlingRights |= WHITE_QUEEN_SIDE_CASTLE;
+					break;
+				case 'k':
+					pos.castlingRights |= BLACK_KING_SIDE_CASTLE;
+					break;
+				case 'q':
+					pos.castlingRights |= BLACK_QUEEN_SIDE_CASTLE;
+					break;
+				default:
+					return pos;
 			}
 		}
+	}
 
-		if (activeColorStr == "w") {
-			pos.usColor = WHITE;
-			pos.oppColor = BLACK;
-		}
-		else if (activeColorStr == "b") {
-			pos.usColor = BLACK;
-			pos.oppColor = WHITE;
-		}
-		else {
+	pos.epSquare = 0ULL;
+	if (epSqStr != "-") {
+		if (epSqStr.size() != 2) {
 			return pos;
 		}
 
-		pos.castlingRights = 0;
-		if (castlingRightsStr != "-") {
-			for (char c : castlingRightsStr) {
-				switch (c) {
-					case 'K':
-						pos.castlingRights |= WHITE_KING_SIDE_CASTLE;
-						break;
-					case 'Q':
-						pos.castlingRights |= WHITE_QUEEN_SIDE_CASTLE;
-						break;
-					case 'k':
-						pos.castlingRights |= BLACK_KING_SIDE_CASTLE;
-						break;
-					case 'q':
-						pos.castlingRights |= BLACK_QUEEN_SIDE_CASTLE;
-						break;
-					default:
-						return pos;
-				}
-			}
-		}
-
-		pos.epSquare = 0ULL;
-		if (epSqStr != "-") {
-			if (epSqStr.size() != 2) {
-				return pos;
-			}
+		int epFile = epSqStr[0] - 'a';
+		int epRank = epSqStr[1] - '1';
 
-			int epFile = epSqStr[0] - 'a';
-			int epRank = epSqStr[1] - '1';
-
-			if (epFile < 0 || epFile > 7 || epRank < 0 || epRank > 7) {
-				return pos;
-			}
-
-			pos.epSquare = (1ULL << (epRank * 8 + epFile));
-		}
-
-		int value = std::stoi(rule50Str);
-		if (value < 0) {
+		if (epFile < 0 || epFile > 7 || epRank < 0 || epRank > 7) {
 			return pos;
 		}
-		pos.rule50 = value;
 
-		success = true;
-		pos.hash = pos.computeHash();
-		pos.hashHistory.clear();
-		pos.saveHash();
-		return pos;
+		pos.epSquare = (1ULL << (epRank * 8 + epFile));
+	}
 
-	} catch (...) {
-		success = false;
-		return pos;
+	// half-move clock, EPD records have operations here instead
+	const std::string_view rule50Str = nextField(fen, cursor);
+	if (!rule50Str.empty() && (std::isdigit(static_cast<unsigned char>(rule50Str[0])) ||
+	                           rule50Str[0] == '-')) {
+		const char *end = rule50Str.data() + rule50Str.size();
+		auto [ptr, ec] = std::from_chars(rule50Str.data(), end, pos.rule50);
+		if (ec != std::errc() || ptr != end || pos.rule50 < 0) {
+			return pos;
+		}
 	}
+
+	success = true;
+	pos.hash ^= pos.computeStateHash();
+	return pos;
 }
 
 bool Position::operator==(const Position &other) const noexcept {
@@ -188,79 +205,128 @@ bool Position::operator==(const Position &other) const noexcept {
 }
 
 std::string Position::toFen(void) const {
-	std::ostringstream stream;
+	char fen[MAX_FEN_LENGTH];
+	return std::string(fen, writeFen(fen));
+}
 
-	static const char pieceIdxToChar[12] = {'P', 'N', 'B', 'R', 'Q', 'K',
-	                                        'p', 'n', 'b', 'r', 'q', 'k'};
+size_t Position::writeFen(char *out) const noexcept {
+	char *cursor = out;
 
 	// piece placement
 	for (int rank = 7; rank >= 0; rank--) {
 		int runningEmptyCount = 0;
 		for (int file = 0; file < 8; file++) {
-			uint64_t pieceBb = 1ULL << (rank * 8 + file);
-			bool found = false;
-
-			for (int pieceIdx = 0; pieceIdx < 12; pieceIdx++) {
-				if (pieces[pieceIdx] & pieceBb) {
-					if (runningEmptyCount) {
-						stream << runningEmptyCount;
-						runningEmptyCount = 0;
-					}
-					stream << pieceIdxToChar[pieceIdx];
-					found = true;
-					break;
-				}
-			}
-			if (!found) {
+			const int piece = board[rank * 8 + file];
+			if (piece == NO_PIECE) {
 				runningEmptyCount++;
+				continue;
+			}
+			if (runningEmptyCount) {
+				*cursor++ = static_cast<char>('0' + runningEmptyCount);
+				runningEmptyCount = 0;
 			}
+			*cursor++ = PIECE_CHARS[piece];
 		}
 		if (runningEmptyCount) {
-			stream << runningEmptyCount;
+			*cursor++ = static_cast<char>('0' + runningEmptyCount);
 		}
 		if (rank > 0) {
-			stream << '/';
+			*cursor++ = '/';
 		}
 	}
 
 	// active color
-	stream << ' ' << (usColor == WHITE ? 'w' : 'b');
+	*cursor++ = ' ';
+	*cursor++ = usColor == WHITE ? 'w' : 'b';
 
 	// castling rights
-	stream << ' ';
+	*cursor++ = ' ';
 	if (!castlingRights) {
-		stream << '-';
+		*cursor++ = '-';
 	}
 	else {
 		if (castlingRights & WHITE_KING_SIDE_CASTLE) {
-			stream << 'K';
+			*cursor++ = 'K';
 		}
 		if (castlingRights & WHITE_QUEEN_SIDE_CASTLE) {
-			stream << 'Q';
+			*cursor++ = 'Q';
 		}
 		if (castlingRights & BLACK_KING_SIDE_CASTLE) {
-			stream << 'k';
+			*cursor++ = 'k';
 		}
 		if (castlingRights & BLACK_QUEEN_SIDE_CASTLE) {
-			stream << 'q';
+			*cursor++ = 'q';
 		}
 	}
 
 	// en-passant square
-	stream << ' ';
+	*cursor++ = ' ';
 	if (!epSquare) {
-		stream << '-';
+		*cursor++ = '-';
 	}
 	else {
 		int sq = std::countr_zero(epSquare);
-		int f = sq % 8;
-		int r = sq / 8;
-		stream << char('a' + f) << char('1' + r);
+		*cursor++ = static_cast<char>('a' + sq % 8);
+		*cursor++ = static_cast<char>('1' + sq / 8);
 	}
 
 	// half-move and full-move clocks
-	stream << ' ' << rule50 << ' ' << 1;  // full-move clock ignored
-	return stream.str();
+	*cursor++ = ' ';
+	cursor = std::to_chars(cursor, out + MAX_FEN_LENGTH - 3, rule50).ptr;  // room for " 1"
+	*cursor++ = ' ';
+	*cursor++ = '1';  // full-move clock ignored
+	*cursor = '\0';
+	return static_cast<size_t>(cursor - out);
+}
+
+PackedPosition Position::pack(void) const noexcept {
+	PackedPosition packed{};
+	packed.occupancy = occForColor[WHITE] | occForColor[BLACK];
+
+	Bitboard occ = packed.occupancy;
+	for (int i = 0; occ && i < 32; i++) {
+		packed.pieces[i / 2] |= static_cast<uint8_t>(board[std::countr_zero(occ)] << ((i & 1) * 4));
+		occ &= occ - 1;
+	}
+
+	packed.rule50 = static_cast<uint16_t>(std::min(rule50, 0xFFFF));
+	packed.usColor = usColor;
+	packed.castlingRights = castlingRights;
+	packed.epSquare = static_cast<uint8_t>(epSquare ? std::countr_zero(epSquare) : 64);
+	return packed;
+}
+
+Position Position::unpack(const PackedPosition &packed, bool &success) noexcept {
+	success = false;
+
+	Position pos{BoardState{}};
+	std::fill(std::begin(pos.board), std::end(pos.board), NO_PIECE);
+
+	if (std::popcount(packed.occupancy) > 32 || packed.usColor > BLACK ||
+	    packed.castlingRights > 0b1111 || packed.epSquare > 64) {
+		return pos;
+	}
+
+	Bitboard occ = packed.occupancy;
+	uint64_t pieceHash = 0;
+	for (int i = 0; occ; i++) {
+		const int pieceIdx = (packed.pieces[i / 2] >> ((i & 1) * 4)) & 0xF;
+		if (pieceIdx >= 12) return pos;
+
+		pieceHash ^= placePiece(pos, pieceIdx, std::countr_zero(occ));
+		occ &= occ - 1;
+	}
+	finishPlacement(pos, pieceHash);
+
+	pos.rule50 = packed.rule50;
+	pos.usColor = packed.usColor;
+	pos.oppColor = packed.usColor ^ 1;
+	pos.castlingRights = packed.castlingRights;
+	pos.epSquare = packed.epSquare == 64 ? 0ULL : 1ULL << packed.epSquare;
+
+	success = true;
+	pos.hash ^= pos.computeStateHash();
+	return pos;
 }
 
 // rook endpoints used for castling mechanisms
@@ -277,11 +343,60 @@ constexpr Bitboard H8 = 1ULL << 63;
 
 void Position::makeMove(Move move) {
 	if (usColor == WHITE) {
-		makeMoveT<WHITE>(move);
+		makeMoveT<WHITE, true>(move);
 	}
 	else {
-		makeMoveT<BLACK>(move);
+		makeMoveT<BLACK, true>(move);
+	}
+}
+
+void Position::makeMoveWithoutUndo(Move move) {
+	if (usColor == WHITE) {
+		makeMoveT<WHITE, false>(move);
+	}
+	else {
+		makeMoveT<BLACK, false>(move);
+	}
+}
+
+// castling rights that survive a move from or to a square
+static constexpr std::array<uint8_t, 64> CASTLING_KEEP = [] {
+	std::array<uint8_t, 64> table{};
+	table.fill(0b1111);
+	table[0] = 0b1101;   // a1
+	table[4] = 0b1100;   // e1
+	table[7] = 0b1110;   // h1
+	table[56] = 0b0111;  // a8
+	table[60] = 0b0011;  // e8
+	table[63] = 0b1011;  // h8
+	return table;
+}();
+
+uint64_t Position::keyAfter(Move move) const noexcept {
+	const int fromSq = move.getFromSq();
+	const int toSq = move.getToSq();
+	const int piece = board[fromSq];
+	const int promoPt = move.getPromoPt();
+	const int placed = promoPt != PT_NULL ? usColor * 6 + promoPt : piece;
+
+	uint64_t key = hash ^ Z_BLACK_TO_MOVE ^ Z_PSQ[piece][fromSq] ^ Z_PSQ[placed][toSq];
+	if (board[toSq] != NO_PIECE) {
+		key ^= Z_PSQ[board[toSq]][toSq];
+	}
+
+	const int rights = castlingRights & CASTLING_KEEP[fromSq] & CASTLING_KEEP[toSq];
+	key ^= Z_CASTLING[castlingRights] ^ Z_CASTLING[rights];
+
+	if (epSquare) {
+		key ^= Z_EP_FILE[std::countr_zero(epSquare) & 7];
 	}
+	if (piece % 6 == PT_PAWN && (toSq - fromSq == 16 || fromSq - toSq == 16)) {
+		key ^= Z_EP_FILE[toSq & 7];
+	}
+
+	// the rook of a castling move & the pawn taken en passant are left out, a prefetch of the
+	// wrong bucket is harmless
+	return key;
 }
 
 void Position::undoMove(void) {
@@ -294,26 +409,37 @@ void Position::undoMove(void) {
 	}
 }
 
-template <int UsColor>
+template <int UsColor, bool RecordUndo>
 void Position::makeMoveT(Move move) {
 	constexpr int OppColor = UsColor ^ 1;
 
-	UndoInfo &u = undoStack[ply++];
-	u.move = move;
-	u.castlingRights = castlingRights;
-	u.epSquare = epSquare;
-	u.halfmoveClock = rule50;
+	UndoInfo &u = history->undoStack[ply++];
+	history->stateStack[ply].cached = 0;
+	// repetition detection reads the hash, the rest is only needed by undoMove(void)
 	u.hash = hash;
-
-	Bitboard from = move.getFrom();
-	Bitboard to = move.getTo();
-	int movingPt = move.getMovingPt();
+	if constexpr (RecordUndo) {
+		u.move = move;
+		u.castlingRights = castlingRights;
+		u.epSquare = epSquare;
+		u.halfmoveClock = rule50;
+		u.pawnKey = pawnKey;
+		u.materialKey = materialKey;
+		u.psqMg = psqMg;
+		u.psqEg = psqEg;
+		u.phase = static_cast<uint8_t>(phase);
+	}
+
+	const int fromSq = move.getFromSq();
+	const int toSq = move.getToSq();
+	Bitboard from = 1ULL << fromSq;
+	Bitboard to = 1ULL << toSq;
+	int movingPt = board[fromSq] - UsColor * 6;
 	int promoPt = move.getPromoPt();
 	bool isEp = move.getIsEp();
 	bool isCastling = move.getIsCastling();
-
-	int fromSq = std::countr_zero(from);
-	int toSq = std::countr_zero(to);
+	if constexpr (RecordUndo) {
+		u.movedType = static_cast<uint8_t>(movingPt);
+	}
 
 	if (epSquare) {
 		int epFile = std::countr_zero(epSquare) & 7;
@@ -331,50 +457,68 @@ void Position::makeMoveT(Move move) {
 		else {
 			capSquare = to << 8;
 		}
-		// find the pawn on that square
 		capturedType = PT_PAWN;
 		pieces[OppColor * 6 + PT_PAWN] ^= capSquare;
 		occForColor[OppColor] ^= capSquare;
 
 		int capSq = std::countr_zero(capSquare);
+		board[capSq] = NO_PIECE;
 		hash ^= Z_PSQ[OppColor * 6 + PT_PAWN][capSq];
+		pawnKey ^= Z_PSQ[OppColor * 6 + PT_PAWN][capSq];
+		materialKey -= materialUnit(OppColor * 6 + PT_PAWN);
+		psqMg -= PSQ_MG[OppColor * 6 + PT_PAWN][capSq];
+		psqEg -= PSQ_EG[OppColor * 6 + PT_PAWN][capSq];
 	}
-	else {
-		// normal capture
-		Bitboard hit = to & occForColor[OppColor];
-		if (hit) {
-			// find which piece type
-			for (int pt = 0; pt < 6; pt++) {
-				if (pieces[OppColor * 6 + pt] & hit) {
-					capturedType = pt;
-					pieces[OppColor * 6 + pt] ^= hit;
-					occForColor[OppColor] ^= hit;
-
-					int capSq = std::countr_zero(hit);
-					hash ^= Z_PSQ[OppColor * 6 + pt][capSq];
-					break;
-				}
-			}
-		}
+	else if (board[toSq] != NO_PIECE) {
+		// normal capture, the target square can only hold an enemy piece
+		const int captured = board[toSq];
+		capturedType = captured - OppColor * 6;
+		pieces[captured] ^= to;
+		occForColor[OppColor] ^= to;
+
+		hash ^= Z_PSQ[captured][toSq];
+		if (capturedType == PT_PAWN) pawnKey ^= Z_PSQ[captured][toSq];
+		materialKey -= materialUnit(captured);
+		psqMg -= PSQ_MG[captured][toSq];
+		psqEg -= PSQ_EG[captured][toSq];
+		phase -= PHASE_WEIGHT[capturedType];
+	}
+	if constexpr (RecordUndo) {
+		u.capturedType = static_cast<uint8_t>(capturedType);
 	}
-	u.capturedType = static_cast<uint8_t>(capturedType);
 
 	// move the actual piece
 	int base = UsColor * 6 + movingPt;
 	pieces[base] ^= (from | to);
 	occForColor[UsColor] ^= (from | to);
+	board[fromSq] = NO_PIECE;
 
 	hash ^= Z_PSQ[base][fromSq];
+	psqMg -= PSQ_MG[base][fromSq];
+	psqEg -= PSQ_EG[base][fromSq];
+	if (movingPt == PT_PAWN) {
+		pawnKey ^= Z_PSQ[base][fromSq];
+		if (promoPt == PT_NULL) pawnKey ^= Z_PSQ[base][toSq];
+	}
 
 	// promotions
 	if (promoPt != PT_NULL) {
+		const int promoted = UsColor * 6 + promoPt;
 		pieces[base] ^= to;
-		pieces[UsColor * 6 + promoPt] ^= to;
+		pieces[promoted] ^= to;
+		board[toSq] = static_cast<uint8_t>(promoted);
 
-		hash ^= Z_PSQ[UsColor * 6 + promoPt][toSq];
+		hash ^= Z_PSQ[promoted][toSq];
+		materialKey += materialUnit(promoted) - materialUnit(base);
+		psqMg += PSQ_MG[promoted][toSq];
+		psqEg += PSQ_EG[promoted][toSq];
+		phase += PHASE_WEIGHT[promoPt];
 	}
 	else {
+		board[toSq] = static_cast<uint8_t>(base);
 		hash ^= Z_PSQ[base][toSq];
+		psqMg += PSQ_MG[base][toSq];
+		psqEg += PSQ_EG[base][toSq];
 	}
 
 	// move rook when castling
@@ -390,6 +534,10 @@ void Position::makeMoveT(Move move) {
 				int rookTo = std::countr_zero(F1);
 				hash ^= Z_PSQ[PT_ROOK][rookFrom];
 				hash ^= Z_PSQ[PT_ROOK][rookTo];
+				board[rookFrom] = NO_PIECE;
+				board[rookTo] = PT_ROOK;
+				psqMg += PSQ_MG[PT_ROOK][rookTo] - PSQ_MG[PT_ROOK][rookFrom];
+				psqEg += PSQ_EG[PT_ROOK][rookTo] - PSQ_EG[PT_ROOK][rookFrom];
 			}
 			else {
 				// queen side: rook A1 -> D1
@@ -400,6 +548,10 @@ void Position::makeMoveT(Move move) {
 				int rookTo = std::countr_zero(D1);
 				hash ^= Z_PSQ[PT_ROOK][rookFrom];
 				hash ^= Z_PSQ[PT_ROOK][rookTo];
+				board[rookFrom] = NO_PIECE;
+				board[rookTo] = PT_ROOK;
+				psqMg += PSQ_MG[PT_ROOK][rookTo] - PSQ_MG[PT_ROOK][rookFrom];
+				psqEg += PSQ_EG[PT_ROOK][rookTo] - PSQ_EG[PT_ROOK][rookFrom];
 			}
 		}
 		else {
@@ -413,6 +565,10 @@ void Position::makeMoveT(Move move) {
 				int rookTo = std::countr_zero(F8);
 				hash ^= Z_PSQ[6 + PT_ROOK][rookFrom];
 				hash ^= Z_PSQ[6 + PT_ROOK][rookTo];
+				board[rookFrom] = NO_PIECE;
+				board[rookTo] = 6 + PT_ROOK;
+				psqMg += PSQ_MG[6 + PT_ROOK][rookTo] - PSQ_MG[6 + PT_ROOK][rookFrom];
+				psqEg += PSQ_EG[6 + PT_ROOK][rookTo] - PSQ_EG[6 + PT_ROOK][rookFrom];
 			}
 			else {
 				// queen side: rook A8 -> D8
@@ -423,6 +579,10 @@ void Position::makeMoveT(Move move) {
 				int rookTo = std::countr_zero(D8);
 				hash ^= Z_PSQ[6 + PT_ROOK][rookFrom];
 				hash ^= Z_PSQ[6 + PT_ROOK][rookTo];
+				board[rookFrom] = NO_PIECE;
+				board[rookTo] = 6 + PT_ROOK;
+				psqMg += PSQ_MG[6 + PT_ROOK][rookTo] - PSQ_MG[6 + PT_ROOK][rookFrom];
+				psqEg += PSQ_EG[6 + PT_ROOK][rookTo] - PSQ_EG[6 + PT_ROOK][rookFrom];
 			}
 		}
 	}
@@ -487,11 +647,16 @@ void Position::makeMoveT(Move move) {
 
 template <int UsColor>
 void Position::undoMoveT() {
-	UndoInfo &u = undoStack[--ply];
+	UndoInfo &u = history->undoStack[--ply];
 	epSquare = u.epSquare;
 	rule50 = u.halfmoveClock;
 	castlingRights = u.castlingRights;
 	hash = u.hash;
+	pawnKey = u.pawnKey;
+	materialKey = u.materialKey;
+	psqMg = u.psqMg;
+	psqEg = u.psqEg;
+	phase = u.phase;
 
 	usColor ^= 1;
 	oppColor ^= 1;
@@ -502,7 +667,7 @@ void Position::undoMoveT() {
 	Move move = u.move;
 	Bitboard from = move.getFrom();
 	Bitboard to = move.getTo();
-	int movingPt = move.getMovingPt();
+	int movingPt = u.movedType;
 	int promoPt = move.getPromoPt();
 	bool isEp = move.getIsEp();
 	bool isCastling = move.getIsCastling();
@@ -515,10 +680,14 @@ void Position::undoMoveT() {
 			if (to == G1) {
 				pieces[PT_ROOK] ^= (F1 | H1);
 				occForColor[WHITE] ^= (F1 | H1);
+				board[std::countr_zero(F1)] = NO_PIECE;
+				board[std::countr_zero(H1)] = PT_ROOK;
 			}
 			else {  // to == C1
 				pieces[PT_ROOK] ^= (D1 | A1);
 				occForColor[WHITE] ^= (D1 | A1);
+				board[std::countr_zero(D1)] = NO_PIECE;
+				board[std::countr_zero(A1)] = PT_ROOK;
 			}
 		}
 		else {
@@ -526,10 +695,14 @@ void Position::undoMoveT() {
 			if (to == G8) {
 				pieces[6 + PT_ROOK] ^= (F8 | H8);
 				occForColor[BLACK] ^= (F8 | H8);
+				board[std::countr_zero(F8)] = NO_PIECE;
+				board[std::countr_zero(H8)] = 6 + PT_ROOK;
 			}
 			else {  // to == C8
 				pieces[6 + PT_ROOK] ^= (D8 | A8);
 				occForColor[BLACK] ^= (D8 | A8);
+				board[std::countr_zero(D8)] = NO_PIECE;
+				board[std::countr_zero(A8)] = 6 + PT_ROOK;
 			}
 		}
 	}
@@ -545,6 +718,8 @@ void Position::undoMoveT() {
 		pieces[base] ^= (from | to);
 		occForColor[UsColor] ^= (from | to);
 	}
+	board[move.getFromSq()] = static_cast<uint8_t>(base);
+	board[move.getToSq()] = NO_PIECE;
 
 	// restore captured piece
 	if (capturedType != PT_NULL) {
@@ -562,47 +737,44 @@ void Position::undoMoveT() {
 		}
 		pieces[OppColor * 6 + capturedType] ^= capturedSquare;
 		occForColor[OppColor] ^= capturedSquare;
+		board[std::countr_zero(capturedSquare)] = static_cast<uint8_t>(OppColor * 6 + capturedType);
 	}
 }
 
-void Position::resetPly(void) { ply = 0; }
-
-bool Position::is50MoveDraw(void) const noexcept {
-	// 100 half-moves = 50 full moves
-	return rule50 >= 100;
+void Position::undoMove(const BoardState &before) noexcept {
+	// the hash written by makeMoveWithoutUndo is left alone, it is overwritten by the next move
+	static_cast<BoardState &>(*this) = before;
+	ply--;
 }
 
-bool Position::isInsufficientMaterial(void) const noexcept {
-	// 1. Fast fail: If there are ANY pawns, rooks, or queens, it's not insufficient material.
-	if (pieces[PT_PAWN] | pieces[PT_PAWN + 6] | pieces[PT_ROOK] | pieces[PT_ROOK + 6] |
-	    pieces[PT_QUEEN] | pieces[PT_QUEEN + 6]) {
-		return false;
-	}
-
-	// 2. Count the remaining minor pieces
-	int wKnights = std::popcount(pieces[PT_KNIGHT]);
-	int bKnights = std::popcount(pieces[PT_KNIGHT + 6]);
-	int wBishops = std::popcount(pieces[PT_BISHOP]);
-	int bBishops = std::popcount(pieces[PT_BISHOP + 6]);
-
-	int totalMinors = wKnights + bKnights + wBishops + bBishops;
+void Position::resetPly(void) {
+	// the cached state at ply 0 may belong to an earlier position
+	ply = 0;
+	history->stateStack[0].cached = 0;
+}
 
-	// Scenarios 1 & 2: King vs King, or King + 1 Minor vs King
-	if (totalMinors <= 1) {
-		return true;
-	}
+void Position::setHistory(PositionHistory *stacks) {
+	history = stacks;
+	history->hashHistory.clear();
+	saveHash();
+	resetPly();
+}
 
-	// Scenario 3: King + Bishop vs King + Bishop (Bishops must be on the same square color)
-	if (totalMinors == 2 && wBishops == 1 && bBishops == 1) {
-		constexpr uint64_t LIGHT_SQUARES = 0x55AA55AA55AA55AAULL;
+void Position::moveHistoryTo(PositionHistory *stacks) {
+	assert(ply == 0 && history && history != stacks);
 
-		bool wLight = (pieces[PT_BISHOP] & LIGHT_SQUARES) != 0;
-		bool bLight = (pieces[PT_BISHOP + 6] & LIGHT_SQUARES) != 0;
+	// repetitions can't reach back past the last irreversible move, so that is all we keep
+	const std::vector<uint64_t> &game = history->hashHistory;
+	const size_t keep = std::min(game.size(), static_cast<size_t>(rule50) + 1);
+	stacks->hashHistory.assign(game.end() - static_cast<std::ptrdiff_t>(keep), game.end());
 
-		return wLight == bLight;
-	}
+	history = stacks;
+	resetPly();
+}
 
-	return false;
+bool Position::is50MoveDraw(void) const noexcept {
+	// 100 half-moves = 50 full moves
+	return rule50 >= 100;
 }
 
 bool Position::isRepetition(void) const noexcept {
@@ -635,23 +807,23 @@ bool Position::isRepetition(void) const noexcept {
     }
 
     for (int i = ply - 2; i >= searchLimit; i -= 2) {
-        if (undoStack[i].hash == this->hash) {
+        if (history->undoStack[i].hash == this->hash) {
             return true;
         }
     }
 
     int remainingHalfMoves = rule50 - ply;
 
-    if (remainingHalfMoves > 0 && !hashHistory.empty()) {
-        int historyLimit = static_cast<int>(hashHistory.size()) - 1 - remainingHalfMoves;
+    if (remainingHalfMoves > 0 && !history->hashHistory.empty()) {
+        int historyLimit = static_cast<int>(history->hashHistory.size()) - 1 - remainingHalfMoves;
         if (historyLimit < 0) {
             historyLimit = 0;
         }
 
-        const int start = static_cast<int>(hashHistory.size()) - 3 + (ply & 1);
+        const int start = static_cast<int>(history->hashHistory.size()) - 3 + (ply & 1);
 
         for (int i = start; i >= historyLimit; i -= 2) {
-            if (hashHistory[i] == this->hash) {
+            if (history->hashHistory[i] == this->hash) {
                 return true;
             }
         }
@@ -672,7 +844,22 @@ uint64_t Position::computeHash(void) {
         }
     }
 
-    h ^= Z_CASTLING[castlingRights];
+    return h ^ computeStateHash();
+}
+
+uint64_t Position::computePawnKey(void) const noexcept {
+    uint64_t h = 0;
+    for (int color = 0; color < 2; color++) {
+        const int p = color * 6 + PT_PAWN;
+        for (Bitboard b = pieces[p]; b; b &= b - 1) {
+            h ^= Z_PSQ[p][std::countr_zero(b)];
+        }
+    }
+    return h;
+}
+
+uint64_t Position::computeStateHash(void) const noexcept {
+    uint64_t h = Z_CASTLING[castlingRights];
 
     if (epSquare) {
         int file = std::countr_zero(epSquare) & 7;
@@ -686,4 +873,29 @@ uint64_t Position::computeHash(void) {
     return h;
 }
 
-void Position::saveHash(void) noexcept { hashHistory.emplace_back(hash); }
+void Position::computeBoard(void) {
+	std::fill(std::begin(board), std::end(board), NO_PIECE);
+	for (int p = 0; p < 12; p++) {
+		Bitboard b = pieces[p];
+		while (b) {
+			board[std::countr_zero(b)] = static_cast<uint8_t>(p);
+			b &= b - 1;
+		}
+	}
+}
+
+void Position::computeEvalSums(void) {
+	psqMg = psqEg = 0;
+	phase = 0;
+	materialKey = 0;
+	for (int sq = 0; sq < 64; sq++) {
+		const int piece = board[sq];
+		if (piece == NO_PIECE) continue;
+		psqMg += PSQ_MG[piece][sq];
+		psqEg += PSQ_EG[piece][sq];
+		phase += PHASE_WEIGHT[piece % 6];
+		materialKey += materialUnit(piece);
+	}
+}
+
+void Position::saveHash(void) noexcept { history->hashHistory.emplace_back(hash); }
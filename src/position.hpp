@@ -3,66 +3,162 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 #include "misc.hpp"
 #include "move.hpp"
 
+// material key: the count of every piece index packed in 4 bits, kings left out. Exact, so it
+// identifies a material configuration without collisions
+constexpr uint64_t materialUnit(int pieceIdx) {
+	return pieceIdx % 6 == PT_KING ? 0 : 1ULL << (4 * pieceIdx);
+}
+constexpr int materialCount(uint64_t materialKey, int pieceIdx) {
+	return static_cast<int>((materialKey >> (4 * pieceIdx)) & 15);
+}
+
 // undo info for a single move
 struct UndoInfo {
 	Bitboard epSquare;
 	Move move;
 	int halfmoveClock;
 	uint8_t castlingRights;
+	uint8_t movedType;
 	uint8_t capturedType;
+	uint8_t phase;
+	uint64_t hash;
+	uint64_t pawnKey;
+	uint64_t materialKey;
+	Score psqMg;
+	Score psqEg;
+};
+
+// mailbox value of an empty square, occupied squares hold color * 6 + piece type
+constexpr uint8_t NO_PIECE = 12;
+
+// check & attack data of the position at one ply, filled lazily by the move generator
+constexpr uint8_t STATE_CHECKERS = 1;
+constexpr uint8_t STATE_PINNED = 1 << 1;
+constexpr uint8_t STATE_ATTACKED = 1 << 2;
+
+struct StateInfo {
+	Bitboard checkers;  // enemy pieces giving check
+	Bitboard pinned;    // our pieces pinned to our king
+	Bitboard attacked;  // squares attacked by the enemy, seen through our king
+	uint8_t cached;     // which of the above are valid (STATE_* bits)
+};
+
+// undo, cached state & repetition stacks of one game or search thread, kept outside of Position so
+// copying a position only copies the board
+struct PositionHistory {
+	UndoInfo undoStack[MAX_PLY];
+	StateInfo stateStack[MAX_PLY + 1];
+
+	// Since we reset ply at the start of each search, we loose information about previous zobrist
+	// hashes that we need for three-fold repetition detection. All other hashs are stored in the
+	// undo stack
+	std::vector<uint64_t> hashHistory;
+};
+
+// board state, trivially copyable so it can be copied per thread or saved for copy-make
+struct BoardState {
+	Bitboard occForColor[2];
+	Bitboard pieces[12];
+	uint8_t board[64];  // mailbox mirror of pieces
+	Bitboard epSquare;
 	uint64_t hash;
+	uint64_t pawnKey;      // zobrist key of the pawns only
+	uint64_t materialKey;  // piece counts, see materialUnit
+	int rule50;
+	Score psqMg;  // material + piece-square sums (white - black), see eval
+	Score psqEg;
+	int phase;  // non-pawn material left, PHASE_MAX at the start
+	uint8_t castlingRights;
+	uint8_t usColor;
+	uint8_t oppColor;
+};
+
+// longest FEN writeFen can produce, including the terminating zero
+constexpr size_t MAX_FEN_LENGTH = 128;
+
+// fixed-size binary position: occupancy, a nibble per occupied square in square order & the state
+struct PackedPosition {
+	Bitboard occupancy;
+	uint8_t pieces[16];  // piece index (color * 6 + piece type), low nibble first
+	uint16_t rule50;
+	uint8_t usColor;
+	uint8_t castlingRights;
+	uint8_t epSquare;  // 64 if there is none
+	uint8_t reserved[3];
 };
 
-// chess position representation
-struct Position {
-	static Position fromFen(const std::string &fen, bool &success) noexcept;
+static_assert(sizeof(PackedPosition) == 32);
+
+// chess position representation, moves can only be made once it is bound to a history
+struct Position : BoardState {
+	// FEN & EPD parsing without allocations, the move clocks are optional & EPD operations ignored
+	static Position fromFen(std::string_view fen, bool &success) noexcept;
+	static Position unpack(const PackedPosition &packed, bool &success) noexcept;
 
 	Position(void);
 
 	bool operator==(const Position &other) const noexcept;
 
 	std::string toFen(void) const;
+	size_t writeFen(char *out) const noexcept;  // out needs MAX_FEN_LENGTH bytes, returns the length
+	PackedPosition pack(void) const noexcept;
 	void makeMove(Move move);
+	uint64_t keyAfter(Move move) const noexcept;  // hash after the move, for prefetching
 	void undoMove(void);
+	// copy-make: skips the undo info except for the hash, undone by restoring the saved board
+	void makeMoveWithoutUndo(Move move);
+	void undoMove(const BoardState &before) noexcept;
 	void resetPly(void);
 
+	// starts a new game history at this position
+	void setHistory(PositionHistory *stacks);
+	// continues the game history on other stacks, e.g. those of a search thread (ply 0 only)
+	void moveHistoryTo(PositionHistory *stacks);
+
+	// state of the current ply, invalidated whenever a move is made
+	StateInfo &stateInfo(void) noexcept { return history->stateStack[ply]; }
+
+	// piece on a square (color * 6 + piece type), NO_PIECE if it is empty
+	int pieceOn(int sq) const noexcept { return board[sq]; }
+
+	// piece type of the given color on a square, PT_NULL if there is none
+	int pieceTypeOn(int sq, int color) const noexcept {
+		const int piece = board[sq];
+		return piece / 6 == color ? piece % 6 : PT_NULL;
+	}
+
 	// draw detection
 	void saveHash(void) noexcept;
 	bool is50MoveDraw(void) const noexcept;
-	bool isInsufficientMaterial(void) const noexcept;
 	bool isRepetition(void) const noexcept;
 
-	// board state
-	Bitboard occForColor[2];
-	Bitboard pieces[12];
-	Bitboard epSquare;
-	int rule50;
-	uint8_t castlingRights;
-	uint8_t usColor;
-	uint8_t oppColor;
-
-	uint64_t hash;
-
 	int ply = 0;
 
-	// Since we reset ply at the start of each search, we loose information about previous zobrist
-	// hashes that we need for three-fold repetition detection. All other hashs are stored in the
-	// undo stack
-	std::vector<uint64_t> hashHistory;
-
    private:
-	UndoInfo undoStack[MAX_PLY];
+	PositionHistory *history = nullptr;
 
-	template <int UsColor>
+	explicit Position(const BoardState &state) noexcept : BoardState(state) {}
+
+	template <int UsColor, bool RecordUndo>
 	void makeMoveT(Move move);
 	template <int UsColor>
 	void undoMoveT(void);
 
 	uint64_t computeHash(void);
+	uint64_t computePawnKey(void) const noexcept;
+	uint64_t computeStateHash(void) const noexcept;  // castling, ep & side to move keys
+	void computeBoard(void);
+	void computeEvalSums(void);
 };
 
+static_assert(std::is_trivially_copyable_v<BoardState>);
+static_assert(std::is_trivially_copyable_v<Position>);
+
 #endif  // POSITION_HPP
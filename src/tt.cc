@@ -1,88 +1,391 @@
 #include "tt.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "zobrist.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(Move) == sizeof(uint16_t));
+static_assert(std::atomic_ref<uint64_t>::is_always_lock_free);
+
+// start of a saved table, the buckets follow at FILE_HEADER_BYTES. Words are stored in native
+// byte order, the seed rejects files whose keys would not match this build
+struct TTFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t entryBytes;
+	uint32_t bucketSize;
+	uint32_t age;
+	uint64_t zobristSeed;
+	uint64_t bucketCount;
+};
+
+static constexpr char TT_FILE_MAGIC[8] = {'K', 'R', 'H', 'A', 'S', 'H', '\0', '\0'};
+static constexpr uint32_t TT_FILE_VERSION = 1;
+
+// mate scores keep their distance to mate in the top MAX_PLY values of the 16 bit range, the rest
+// are clamped below them
+static constexpr int PACKED_MATE = std::numeric_limits<int16_t>::max();
+static constexpr int PACKED_MATE_MIN = PACKED_MATE - MAX_PLY;
+
+static uint16_t packValue(Score value) {
+	int packed;
+	if (value >= -MATED_SCORE - MAX_PLY) {
+		packed = PACKED_MATE - (-MATED_SCORE - value);
+	}
+	else if (value <= MATED_SCORE + MAX_PLY) {
+		packed = -PACKED_MATE + (value - MATED_SCORE);
+	}
+	else {
+		packed = std::clamp(value, -PACKED_MATE_MIN + 1, PACKED_MATE_MIN - 1);
+	}
+	return static_cast<uint16_t>(packed);
+}
+
+static Score unpackValue(uint16_t bits) {
+	const int packed = static_cast<int16_t>(bits);
+	if (packed >= PACKED_MATE_MIN) return -MATED_SCORE - (PACKED_MATE - packed);
+	if (packed <= -PACKED_MATE_MIN) return MATED_SCORE + (packed + PACKED_MATE);
+	return packed;
+}
+
+// bits 0-15 key tag, 16-31 move, 32-47 value, 48-55 depth, 56-57 flag, 58-63 age
+uint64_t TTEntry::pack(void) const {
+	return static_cast<uint64_t>(keyTag) |
+	       static_cast<uint64_t>(std::bit_cast<uint16_t>(bestMove)) << 16 |
+	       static_cast<uint64_t>(packValue(value)) << 32 |
+	       static_cast<uint64_t>(static_cast<uint8_t>(depth)) << 48 |
+	       static_cast<uint64_t>(flag & 3) << 56 | static_cast<uint64_t>(age & 63) << 58;
+}
+
+TTEntry TTEntry::unpack(uint64_t data) {
+	TTEntry entry;
+	entry.keyTag = static_cast<uint16_t>(data);
+	entry.bestMove = std::bit_cast<Move>(static_cast<uint16_t>(data >> 16));
+	entry.value = unpackValue(static_cast<uint16_t>(data >> 32));
+	entry.depth = static_cast<int8_t>(data >> 48);
+	entry.flag = static_cast<uint8_t>((data >> 56) & 3);
+	entry.age = static_cast<uint8_t>(data >> 58);
+	return entry;
+}
 
 TTEntry TTEntry::makeEmptyEntry(void) {
 	TTEntry entry;
 	entry.bestMove = Move();
 	entry.value = 0;
-	entry.age = std::numeric_limits<uint16_t>::max();
 	entry.keyTag = std::numeric_limits<uint16_t>::max();
 	entry.depth = -1;
-	entry.flag = static_cast<uint8_t>(TT_UPPER);
+	entry.flag = TT_UPPER;
+	entry.age = 0;
 	return entry;
 }
 
-TranspositionTable::~TranspositionTable(void) {
-	if (table) {
-		delete[] table;
+static inline uint64_t loadWord(const uint64_t &word) {
+	return std::atomic_ref<uint64_t>(const_cast<uint64_t &>(word)).load(std::memory_order_relaxed);
+}
+
+static inline void storeWord(uint64_t &word, uint64_t data) {
+	std::atomic_ref<uint64_t>(word).store(data, std::memory_order_relaxed);
+}
+
+static inline void countStat(uint64_t &counter) {
+	std::atomic_ref<uint64_t>(counter).fetch_add(1, std::memory_order_relaxed);
+}
+
+TranspositionTable::~TranspositionTable(void) { release(); }
+
+// random probes over a big table miss the TLB on nearly every access with 4 KiB pages. Explicit
+// 2 MiB pages are tried first, then transparent huge pages, then plain pages
+void TranspositionTable::allocate(size_t bytes) {
+	allocBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#if defined(__linux__)
+	void *mem = mmap(nullptr, allocBytes, PROT_READ | PROT_WRITE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (mem != MAP_FAILED) {
+		table = static_cast<Bucket *>(mem);
+		pages = TTPages::EXPLICIT;
+		return;
 	}
+#endif
+
+	table = static_cast<Bucket *>(
+	    ::operator new(allocBytes, std::align_val_t{HUGE_PAGE_SIZE}, std::nothrow));
+	pages = TTPages::NORMAL;
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if (table && madvise(table, allocBytes, MADV_HUGEPAGE) == 0) {
+		pages = TTPages::TRANSPARENT;
+	}
+#endif
+}
+
+void TranspositionTable::release(void) {
+	if (!table) return;
+
+#if defined(__linux__)
+	if (pages == TTPages::EXPLICIT) {
+		munmap(table, allocBytes);
+	}
+	else if (pages == TTPages::MAPPED) {
+		munmap(reinterpret_cast<char *>(table) - FILE_HEADER_BYTES, allocBytes);
+	}
+	else
+#endif
+	{
+		::operator delete(table, std::align_val_t{HUGE_PAGE_SIZE});
+	}
+
+	table = nullptr;
+	bucketCount = 0;
+	allocBytes = 0;
 }
 
 void TranspositionTable::clear(void) {
-	if (table && capacity != 0) {
-		const TTEntry empty = TTEntry::makeEmptyEntry();
-		std::fill(table, table + capacity, empty);
+	resetStats();
+	if (!table || bucketCount == 0) return;
+
+	Bucket empty;
+	std::fill(std::begin(empty.entries), std::end(empty.entries), TTEntry::makeEmptyEntry().pack());
+
+	// every core clears a slice; the first touch also places the pages on the NUMA node of the
+	// thread that clears them, spreading the table over the nodes
+	const size_t bytes = bucketCount * sizeof(Bucket);
+	const size_t threadCount =
+	    bytes < PARALLEL_CLEAR_MIN ? 1 : std::max(1u, std::thread::hardware_concurrency());
+	const size_t slice = (bucketCount + threadCount - 1) / threadCount;
+
+	auto clearSlice = [this, &empty, slice](size_t idx) {
+		const size_t begin = std::min(bucketCount, idx * slice);
+		const size_t end = std::min(bucketCount, begin + slice);
+		std::uninitialized_fill(table + begin, table + end, empty);
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t idx = 1; idx < threadCount; idx++) {
+		threads.emplace_back(clearSlice, idx);
+	}
+	clearSlice(0);
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
+
+const char *TranspositionTable::pageKind(void) const {
+	switch (pages) {
+		case TTPages::EXPLICIT:
+			return "explicit huge pages";
+		case TTPages::TRANSPARENT:
+			return "transparent huge pages";
+		case TTPages::MAPPED:
+			return "a mapped file";
+		case TTPages::NORMAL:
+		default:
+			return "normal pages";
+	}
+}
+
+bool TranspositionTable::save(const std::string &path) const {
+	if (!table || bucketCount == 0) return false;
+
+	char header[FILE_HEADER_BYTES] = {};
+	TTFileHeader fields;
+	std::memcpy(fields.magic, TT_FILE_MAGIC, sizeof(fields.magic));
+	fields.version = TT_FILE_VERSION;
+	fields.entryBytes = sizeof(uint64_t);
+	fields.bucketSize = BUCKET_SIZE;
+	fields.age = age;
+	fields.zobristSeed = ZOBRIST_SEED;
+	fields.bucketCount = bucketCount;
+	std::memcpy(header, &fields, sizeof(fields));
+
+	// written next to the target & renamed over it, a table mapped from the old file keeps it
+	const std::string tmpPath = path + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		out.write(header, sizeof(header));
+		out.write(reinterpret_cast<const char *>(table),
+		          static_cast<std::streamsize>(bucketCount * sizeof(Bucket)));
+		if (!out.flush()) {
+			out.close();
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+	}
+	return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+bool TranspositionTable::load(const std::string &path) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) return false;
+	const auto fileBytes = static_cast<uint64_t>(in.tellg());
+
+	TTFileHeader fields;
+	in.seekg(0);
+	if (fileBytes < FILE_HEADER_BYTES || !in.read(reinterpret_cast<char *>(&fields), sizeof(fields)) ||
+	    std::memcmp(fields.magic, TT_FILE_MAGIC, sizeof(fields.magic)) != 0 ||
+	    fields.version != TT_FILE_VERSION || fields.entryBytes != sizeof(uint64_t) ||
+	    fields.bucketSize != BUCKET_SIZE || fields.zobristSeed != ZOBRIST_SEED ||
+	    fields.bucketCount == 0 ||
+	    fields.bucketCount != (fileBytes - FILE_HEADER_BYTES) / sizeof(Bucket) ||
+	    (fileBytes - FILE_HEADER_BYTES) % sizeof(Bucket) != 0) {
+		return false;
+	}
+
+#if defined(__linux__)
+	// the pages are read in on first touch, so even a huge table is usable at once. A private
+	// mapping turns stores into copies & leaves the file as it was saved
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	void *mem = mmap(nullptr, fileBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED) return false;
+	madvise(mem, fileBytes, MADV_WILLNEED);  // starts reading ahead in the background
+
+	release();
+	table = reinterpret_cast<Bucket *>(static_cast<char *>(mem) + FILE_HEADER_BYTES);
+	allocBytes = fileBytes;
+	pages = TTPages::MAPPED;
+#else
+	release();
+	allocate(fileBytes - FILE_HEADER_BYTES);
+	if (!table) return false;
+	in.seekg(FILE_HEADER_BYTES);
+	if (!in.read(reinterpret_cast<char *>(table),
+	             static_cast<std::streamsize>(fileBytes - FILE_HEADER_BYTES))) {
+		release();
+		return false;
+	}
+#endif
+
+	bucketCount = fields.bucketCount;
+	age = static_cast<uint8_t>(fields.age & AGE_MASK);
+	resetStats();
+	return true;
+}
+
+void TranspositionTable::resetStats(void) {
+	counters = TTStats();
+	if constexpr (VERIFY_KEYS) {
+		fullKeys.assign(bucketCount * BUCKET_SIZE, 0);
 	}
 }
 
-void TranspositionTable::newSearch(void) { age++; }
+TTStats TranspositionTable::stats(void) const {
+	// counters may still be counted by a running search
+	TTStats snapshot;
+	auto copy = [](const uint64_t &from, uint64_t &to) { to = loadWord(from); };
+	copy(counters.probes, snapshot.probes);
+	copy(counters.hits, snapshot.hits);
+	copy(counters.falseHits, snapshot.falseHits);
+	copy(counters.stores, snapshot.stores);
+	copy(counters.keptDeeper, snapshot.keptDeeper);
+	copy(counters.replacedSame, snapshot.replacedSame);
+	copy(counters.filledEmpty, snapshot.filledEmpty);
+	copy(counters.evicted, snapshot.evicted);
+	for (int i = 0; i < TTStats::DEPTH_BINS; i++) {
+		copy(counters.evictedDepth[i], snapshot.evictedDepth[i]);
+	}
+	for (int i = 0; i < TTStats::AGE_BINS; i++) {
+		copy(counters.evictedAge[i], snapshot.evictedAge[i]);
+	}
+	return snapshot;
+}
+
+int TranspositionTable::hashfull(void) const {
+	if (!table || bucketCount == 0) return 0;
+
+	const size_t sampled = std::min(HASHFULL_SAMPLE, bucketCount);
+	size_t used = 0;
+	for (size_t idx = 0; idx < sampled; idx++) {
+		for (int i = 0; i < BUCKET_SIZE; i++) {
+			const uint64_t data = loadWord(table[idx].entries[i]);
+			if (static_cast<int8_t>(data >> 48) >= 0 && (data >> 58) == age) {
+				used++;
+			}
+		}
+	}
+	return static_cast<int>(used * 1000 / (sampled * BUCKET_SIZE));
+}
+
+void TranspositionTable::newSearch(void) { age = (age + 1) & AGE_MASK; }
 
 void TranspositionTable::resize(size_t mb) {
 	size_t bytes = mb * 1024ULL * 1024ULL;
-	capacity = bytes / sizeof(TTEntry);
-	capacity = std::max<size_t>(CLUSTER_SIZE * 1024, (capacity / CLUSTER_SIZE) * CLUSTER_SIZE);
+	const size_t count = std::max<size_t>(1024, bytes / sizeof(Bucket));
 
-	if (table) {
-		delete[] table;
+	release();
+	allocate(count * sizeof(Bucket));
+	if (!table) {
+		throw std::bad_alloc();
 	}
 
-	table = new TTEntry[capacity];
+	bucketCount = count;
 	clear();
 	age = 0;
 }
 
-bool TranspositionTable::probe(uint64_t key, TTEntry &out) const {
-	if (!table || capacity == 0) {
-		return false;
-	}
-	const size_t base = getClusterBase(key);
-	const uint16_t tag = getKeyTag(key);
+// the bucket scans are cloned per ISA level in portable builds. They are free functions, an
+// attribute on the member definitions alone would differ from the class in the other TUs
+static constexpr int NO_SLOT = -1;
+
+static inline int depthOf(uint64_t data) { return static_cast<int8_t>(data >> 48); }
 
-	for (unsigned i = 0; i < CLUSTER_SIZE; i++) {
-		const TTEntry &entry = table[base + i];
-		if (entry.depth >= 0 && entry.keyTag == tag) {
-			out = entry;
-			return true;
+// slot holding tag, one load per entry; the tag & the depth are checked on the loaded word, so a
+// concurrent store either happened before or after it
+static MULTIVERSION int findSlot(const uint64_t *entries, uint16_t tag, uint64_t &data) {
+	for (int i = 0; i < TranspositionTable::BUCKET_SIZE; i++) {
+		data = loadWord(entries[i]);
+		if (static_cast<uint16_t>(data) == tag && depthOf(data) >= 0) {
+			return i;
 		}
 	}
-	return false;
+	return NO_SLOT;
 }
 
-void TranspositionTable::store(uint64_t key, int depth, Score value, TTFlag flag, Move bestMove) {
-	if (!table || capacity == 0) return;
+enum SlotChoice : uint8_t { SLOT_KEEP, SLOT_SAME, SLOT_EMPTY, SLOT_EVICT };
 
-	const uint16_t tag = getKeyTag(key);
-	const size_t base = getClusterBase(key);
+// slot a new entry replaces, each word is loaded once & only its fields are read, other threads
+// may replace entries meanwhile but never tear one
+static MULTIVERSION SlotChoice pickSlot(const uint64_t *entries, uint16_t tag, int depth,
+                                        int flag, int age, int &slot, uint64_t &old) {
+	constexpr int BucketSize = TranspositionTable::BUCKET_SIZE;
+	uint64_t words[BucketSize];
+	for (int i = 0; i < BucketSize; i++) {
+		words[i] = loadWord(entries[i]);
+	}
 
 	int emptyIdx = -1;
 	int sameIdx = -1;
 
-	for (int i = 0; i < CLUSTER_SIZE; i++) {
-		TTEntry &entry = table[base + static_cast<unsigned>(i)];
-		if (entry.depth < 0 && emptyIdx < 0) {  // pick first empty
+	for (int i = 0; i < BucketSize; i++) {
+		if (depthOf(words[i]) < 0 && emptyIdx < 0) {  // pick first empty
 			emptyIdx = i;
 		}
-		if (entry.keyTag == tag) {  // same position tag
+		if (static_cast<uint16_t>(words[i]) == tag) {  // same position tag
 			sameIdx = i;
 			break;
 		}
 	}
 
-	int victimIdx = -1;
-	auto flagPriority = [](TTFlag entryFlag) {
+	auto flagPriority = [](int entryFlag) {
 		switch (entryFlag) {
 			case TT_EXACT:
 				return 2;
@@ -94,42 +397,96 @@ void TranspositionTable::store(uint64_t key, int depth, Score value, TTFlag flag
 		}
 	};
 	if (sameIdx >= 0) {
-		TTEntry &existing = table[base + static_cast<unsigned>(sameIdx)];
-		const int existingDepth = static_cast<int>(existing.depth);
-		const bool betterFlag =
-		    flagPriority(flag) > flagPriority(static_cast<TTFlag>(existing.flag));
+		slot = sameIdx;
+		old = words[sameIdx];
+		const bool betterFlag = flagPriority(flag) > flagPriority(static_cast<int>((old >> 56) & 3));
+		return !betterFlag && depth < depthOf(old) ? SLOT_KEEP : SLOT_SAME;  // keep deeper entry
+	}
+	if (emptyIdx >= 0) {
+		slot = emptyIdx;
+		old = words[emptyIdx];
+		return SLOT_EMPTY;
+	}
+
+	int bestScoreIdx = 0;
+	int bestScore = -1;  // higher = more replaceable
+	for (int i = 0; i < BucketSize; i++) {
+		const int depthTerm = (127 - depthOf(words[i])) * 256;
+		const int ageTerm = (age - static_cast<int>(words[i] >> 58)) & TranspositionTable::AGE_MASK;
+		const int repScore = depthTerm + ageTerm;
 
-		if (!betterFlag && depth < existingDepth) {
-			return;  // keep deeper entry
+		if (repScore > bestScore) {
+			bestScore = repScore;
+			bestScoreIdx = i;
 		}
+	}
+	slot = bestScoreIdx;
+	old = words[bestScoreIdx];
+	return SLOT_EVICT;
+}
 
-		victimIdx = sameIdx;
+bool TranspositionTable::probe(uint64_t key, TTEntry &out) const {
+	if (!table || bucketCount == 0) {
+		return false;
+	}
+	const size_t bucketIdx = getBucketIdx(key);
+	if constexpr (COUNT_STATS) countStat(counters.probes);
+
+	uint64_t data;
+	const int slot = findSlot(table[bucketIdx].entries, getKeyTag(key), data);
+	if (slot == NO_SLOT) {
+		return false;
 	}
-	else if (emptyIdx >= 0) {
-		victimIdx = emptyIdx;
+
+	out = TTEntry::unpack(data);
+	if constexpr (COUNT_STATS) countStat(counters.hits);
+	if constexpr (VERIFY_KEYS) {
+		const uint64_t fullKey = loadWord(fullKeys[bucketIdx * BUCKET_SIZE + slot]);
+		if (fullKey != 0 && fullKey != key) countStat(counters.falseHits);
 	}
-	else {
-		int bestScoreIdx = 0;
-		int bestScore = -1;  // higher = more replaceable
-		for (int i = 0; i < CLUSTER_SIZE; i++) {
-			TTEntry &e = table[base + static_cast<unsigned>(i)];
-			const int depthTerm = (127 - static_cast<int>(e.depth)) * 256;
-			const int ageTerm = static_cast<int>(static_cast<uint16_t>(age - e.age));
-			const int repScore = depthTerm + ageTerm;
-
-			if (repScore > bestScore) {
-				bestScore = repScore;
-				bestScoreIdx = i;
+	return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Score value, TTFlag flag, Move bestMove) {
+	if (!table || bucketCount == 0) return;
+
+	const uint16_t tag = getKeyTag(key);
+	const size_t bucketIdx = getBucketIdx(key);
+	Bucket &bucket = table[bucketIdx];
+	if constexpr (COUNT_STATS) countStat(counters.stores);
+
+	int victimIdx;
+	uint64_t old;
+	const SlotChoice choice = pickSlot(bucket.entries, tag, depth, flag, age, victimIdx, old);
+	if constexpr (COUNT_STATS) {
+		switch (choice) {
+			case SLOT_KEEP:
+				countStat(counters.keptDeeper);
+				break;
+			case SLOT_SAME:
+				countStat(counters.replacedSame);
+				break;
+			case SLOT_EMPTY:
+				countStat(counters.filledEmpty);
+				break;
+			case SLOT_EVICT: {
+				const int searchesAgo = (age - static_cast<int>(old >> 58)) & AGE_MASK;
+				countStat(counters.evicted);
+				countStat(counters.evictedDepth[std::min(depthOf(old), TTStats::DEPTH_BINS - 1)]);
+				countStat(counters.evictedAge[std::min(searchesAgo, TTStats::AGE_BINS - 1)]);
+				break;
 			}
 		}
-		victimIdx = bestScoreIdx;
 	}
+	if (choice == SLOT_KEEP) return;
 
-	TTEntry &v = table[base + static_cast<unsigned>(victimIdx)];
+	TTEntry v;
 	v.bestMove = bestMove;
 	v.value = value;
 	v.age = age;
 	v.keyTag = tag;
 	v.depth = static_cast<int8_t>(depth);
-	v.flag = static_cast<uint8_t>(flag);
+	v.flag = flag;
+	storeWord(bucket.entries[victimIdx], v.pack());
+	if constexpr (VERIFY_KEYS) storeWord(fullKeys[bucketIdx * BUCKET_SIZE + victimIdx], key);
 }
@@ -1,22 +1,49 @@
 #ifndef TT_HPP
 #define TT_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 #include "misc.hpp"
 #include "move.hpp"
 
 enum TTFlag : uint8_t { TT_EXACT, TT_LOWER, TT_UPPER };
 
+// kind of pages backing the table
+enum class TTPages : uint8_t { NORMAL, TRANSPARENT, EXPLICIT, MAPPED };
+
+// decoded entry. The table keeps every entry packed into one 64 bit word that is written &
+// read atomically, so concurrent searches can share it without locks & never see a torn entry
 struct TTEntry {
 	static TTEntry makeEmptyEntry(void);
+	static TTEntry unpack(uint64_t data);
+	uint64_t pack(void) const;
 
+	Score value;      // value of the node that depends on TTFlag, kept in 16 bits
 	Move bestMove;    // best move from this position
-	Score value;      // value of the node that depends on TTFlag
-	uint16_t age;     // age to replace old entries with newer ones
-	uint16_t keyTag;  // higher 16 bits of the zobrist key
+	uint16_t keyTag;  // lower 16 bits of the zobrist key, the bucket index uses the higher ones
 	int8_t depth;     // how much 'deeper' we searched to compute the value
-	uint8_t flag;     // exact value or alpha/beta cutoff
+	uint8_t flag;     // exact value or alpha/beta cutoff (2 bits)
+	uint8_t age;      // age to replace old entries with newer ones (6 bits)
+};
+
+// counters of a build with KNIGHTRIDER_TT_STATS, kept since the table was last cleared
+struct TTStats {
+	static constexpr int DEPTH_BINS = 16;  // the last bin also holds deeper entries
+	static constexpr int AGE_BINS = 4;     // searches since the store, the last bin also older ones
+
+	uint64_t probes = 0;
+	uint64_t hits = 0;
+	uint64_t falseHits = 0;  // hits on another position with the same tag, debug builds only
+	uint64_t stores = 0;
+	uint64_t keptDeeper = 0;  // stores dropped for a deeper entry of the same position
+	uint64_t replacedSame = 0;
+	uint64_t filledEmpty = 0;
+	uint64_t evicted = 0;  // stores that replaced another position
+	uint64_t evictedDepth[DEPTH_BINS] = {};
+	uint64_t evictedAge[AGE_BINS] = {};
 };
 
 class TranspositionTable {
@@ -26,24 +53,68 @@ class TranspositionTable {
 
 	void clear(void);
 	void newSearch(void);
-	void resize(size_t mb);
+	void resize(size_t mb);  // throws std::bad_alloc, leaving the table empty
+	const char* pageKind(void) const;
+	int hashfull(void) const;  // permille of the first 1000 buckets stored by the current search
+	TTStats stats(void) const;  // all zero unless built with KNIGHTRIDER_TT_STATS
+
+	// a saved table is mapped back copy-on-write instead of being read, the file is never
+	// modified. Both return false on i/o errors or a file saved by an incompatible build
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);
+
 	bool probe(uint64_t key, TTEntry& out) const;
 	void store(uint64_t key, int depth, Score value, TTFlag flag, Move bestMove);
 
+	// pulls the bucket of a key into the cache ahead of its probe
+	inline void prefetch(uint64_t key) const { ::prefetch(&table[getBucketIdx(key)]); }
+
+	static constexpr int BUCKET_SIZE = 4;  // entries per bucket
+	static constexpr int AGE_MASK = 63;    // the age wraps around in 6 bits
+
    private:
-	inline size_t getClusterBase(uint64_t key) const {
-		const size_t numClusters = capacity / CLUSTER_SIZE;
-		const size_t clusterIdx = static_cast<size_t>(key % numClusters);
-		return clusterIdx * CLUSTER_SIZE;
+	static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	static constexpr size_t PARALLEL_CLEAR_MIN = 64 * 1024 * 1024;  // smaller tables clear on 1 thread
+	static constexpr size_t FILE_HEADER_BYTES = 4096;  // keeps the mapped buckets page aligned
+	static constexpr size_t HASHFULL_SAMPLE = 1000;  // buckets sampled by hashfull
+#if defined(KNIGHTRIDER_TT_STATS)
+	static constexpr bool COUNT_STATS = true;
+#else
+	static constexpr bool COUNT_STATS = false;
+#endif
+#if defined(KNIGHTRIDER_TT_STATS) && !defined(NDEBUG)
+	static constexpr bool VERIFY_KEYS = true;
+#else
+	static constexpr bool VERIFY_KEYS = false;
+#endif
+
+	// one bucket per 32 byte half of a cache line, never split over two lines. The words are only
+	// accessed through std::atomic_ref while a search may be running
+	struct alignas(32) Bucket {
+		uint64_t entries[BUCKET_SIZE];
+	};
+	static_assert(sizeof(Bucket) == 32);
+
+	// high half of key * bucketCount, maps the key onto [0, bucketCount) without a division
+	inline size_t getBucketIdx(uint64_t key) const {
+		return static_cast<size_t>(mulHi64(key, bucketCount));
 	}
 
-	static inline uint16_t getKeyTag(uint64_t key) { return static_cast<uint16_t>(key >> 48); }
+	static inline uint16_t getKeyTag(uint64_t key) { return static_cast<uint16_t>(key); }
+
+	void allocate(size_t bytes);  // leaves table null on failure
+	void release(void);
+	void resetStats(void);
 
-	static constexpr int CLUSTER_SIZE = 4;
+	Bucket* table = nullptr;
+	size_t bucketCount = 0;
+	size_t allocBytes = 0;
+	TTPages pages = TTPages::NORMAL;
+	uint8_t age = 0;
 
-	TTEntry* table = nullptr;
-	size_t capacity = 0;
-	uint16_t age = 0;
+	// statistics, only touched when COUNT_STATS is set
+	mutable TTStats counters;
+	std::vector<uint64_t> fullKeys;  // key of every entry, 0 when unknown (VERIFY_KEYS)
 };
 
 #endif  // TT_HPP
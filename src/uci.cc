@@ -3,15 +3,16 @@
 #include <cctype>
 #include <chrono>
 #include <iostream>
+#include <new>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "bitboards.hpp"
 #include "engine.hpp"
+#include "material.hpp"
 #include "movelist.hpp"
 #include "perft.hpp"
-#include "zobrist.hpp"
 
 static std::vector<std::string> tokenizeLine(const std::string& line) {
 	std::istringstream iss(line);
@@ -30,9 +31,14 @@ static inline bool advanceIfPossible(const std::vector<std::string>& tokens, siz
 }
 
 void UciEngine::preUciInit(void) {
-	initBitboards();
-	initZobristTables();
+	setSliderBackend(SLIDER_PEXT);  // falls back to magics on CPUs without BMI2
 	tt.resize(10);  // 10mib default size
+	setPosition(Position());
+}
+
+void UciEngine::setPosition(const Position& newPos) {
+	pos = newPos;
+	pos.setHistory(&history);
 }
 
 void UciEngine::start(void) {
@@ -92,6 +98,15 @@ void UciEngine::start(void) {
 				printSafe("info string 'ponderhit' not implemented yet");
 			}
 		}
+		else if (cmd == "savehash") {
+			handleSaveHashCmd();
+		}
+		else if (cmd == "loadhash") {
+			handleLoadHashCmd();
+		}
+		else if (cmd == "tt") {
+			handleTtCmd();
+		}
 		else if (cmd == "stop") {
 			handleStopCmd();
 		}
@@ -105,8 +120,11 @@ void UciEngine::start(void) {
 void UciEngine::handleUciCmd(void) {
 	printSafe("id name Knightrider");
 	printSafe("id author Viliam Holly");
-	printSafe("option name Hash type spin default 10 min 1 max 512");
+	printSafe("option name Hash type spin default 10 min 1 max 131072");
 	printSafe("option name Clear Hash type button");
+	if (isPextSupported()) {
+		printSafe("option name PEXT type check default true");
+	}
 	printSafe("uciok");
 }
 
@@ -121,6 +139,8 @@ void UciEngine::handleDebugCmd(void) {
 	const std::string& arg = lowerTokens.at(tokenPos);
 	if (arg == "on") {
 		isDebugMode = true;
+		printSafe("info string cpu supports ", cpuIsaLevel(), ", slider attacks use ",
+		          sliderBackend == SLIDER_PEXT ? "PEXT" : "magic", " indexing");
 	}
 	else if (arg == "off") {
 		isDebugMode = false;
@@ -132,10 +152,14 @@ void UciEngine::handleDebugCmd(void) {
 	}
 }
 
-void UciEngine::handleIsReadyCmd(void) { printSafe("readyok"); }
+void UciEngine::handleIsReadyCmd(void) {
+	initKpkBitbase();
+	printSafe("readyok");
+}
 
 void UciEngine::handleUcinewgameCmd(void) {
-	pos = Position();
+	initKpkBitbase();
+	setPosition(Position());
 	if (isDebugMode) {
 		printSafe("info string new UCI game initialized");
 	}
@@ -153,7 +177,7 @@ void UciEngine::handlePositionCmd(void) {
 
 	// startpos
 	if (lowerTokens.at(tokenPos) == "startpos") {
-		pos = Position();
+		setPosition(Position());
 
 		if (!advanceIfPossible(lowerTokens, tokenPos)) {
 			if (isDebugMode) {
@@ -195,13 +219,14 @@ void UciEngine::handlePositionCmd(void) {
 		}
 
 		bool success;
-		pos = Position::fromFen(fen, success);
+		const Position fenPos = Position::fromFen(fen, success);
 		if (!success) {
 			if (isDebugMode) {
 				printSafe("info string invalid FEN string");
 			}
 			return;
 		}
+		setPosition(fenPos);
 		tokenPos = fenEnd;
 	}
 	else {
@@ -383,12 +408,85 @@ void UciEngine::handleGoCmd(void) {
 		std::cout << "\nNodes searched: " << nodes << " in " << elapsedTime << '\n' << std::endl;
 	}
 	else {
+		initKpkBitbase();  // a no-op unless the GUI skipped isready
 		engine.startSearch(pos, &tt, limits, recvTP);
 	}
 }
 
 void UciEngine::handleStopCmd(void) { engine.stopSearch(); }
 
+// the path is the rest of the line in its original case, it may contain spaces
+std::string UciEngine::restOfLine(size_t from) const {
+	std::string rest;
+	for (size_t i = from; i < tokens.size(); i++) {
+		if (!rest.empty()) rest.push_back(' ');
+		rest += tokens[i];
+	}
+	return rest;
+}
+
+void UciEngine::handleSaveHashCmd(void) {
+	// savehash <file>
+	const std::string path = restOfLine(1);
+	if (path.empty()) {
+		printSafe("info string missing file");
+		return;
+	}
+
+	engine.stopSearch();
+	if (!tt.save(path)) {
+		printSafe("info string can't save hash to '", path, "'");
+	}
+	else if (isDebugMode) {
+		printSafe("info string hash saved to '", path, "'");
+	}
+}
+
+void UciEngine::handleTtCmd(void) {
+	// tt stats
+	if (lowerTokens.size() < 2 || lowerTokens[1] != "stats") {
+		printSafe("info string expected 'tt stats'");
+		return;
+	}
+
+	printSafe("info string hashfull ", tt.hashfull(), " on ", tt.pageKind());
+#if defined(KNIGHTRIDER_TT_STATS)
+	const TTStats stats = tt.stats();
+	auto permille = [](uint64_t part, uint64_t total) { return total ? part * 1000 / total : 0; };
+
+	printSafe("info string probes ", stats.probes, " hits ", stats.hits, " (",
+	          permille(stats.hits, stats.probes), " permille) false hits ", stats.falseHits);
+	printSafe("info string stores ", stats.stores, " kept deeper ", stats.keptDeeper,
+	          " same position ", stats.replacedSame, " empty ", stats.filledEmpty, " evicted ",
+	          stats.evicted);
+
+	std::string depths, ages;
+	for (uint64_t count : stats.evictedDepth) depths += " " + std::to_string(count);
+	for (uint64_t count : stats.evictedAge) ages += " " + std::to_string(count);
+	printSafe("info string evicted by depth 0-", TTStats::DEPTH_BINS - 1, "+:", depths);
+	printSafe("info string evicted by searches ago 0-", TTStats::AGE_BINS - 1, "+:", ages);
+#else
+	printSafe("info string build with KNIGHTRIDER_TT_STATS for probe & replacement counters");
+#endif
+}
+
+void UciEngine::handleLoadHashCmd(void) {
+	// loadhash <file>
+	const std::string path = restOfLine(1);
+	if (path.empty()) {
+		printSafe("info string missing file");
+		return;
+	}
+
+	engine.stopSearch();
+	if (!tt.load(path)) {
+		printSafe("info string can't load hash from '", path, "'");
+	}
+	else if (isDebugMode) {
+		printSafe("info string hash loaded from '", path, "' on ", tt.pageKind());
+	}
+}
+
 void UciEngine::handleSetoptionCmd(void) {
 	// setoption name <id> [value <x>]
 	tokenPos = 1;
@@ -438,14 +536,35 @@ void UciEngine::handleSetoptionCmd(void) {
 			tt.resize(static_cast<std::size_t>(mib));
 
 			if (isDebugMode) {
-				printSafe("info string TT resized to ", std::to_string(mib), " MiB");
+				printSafe("info string TT resized to ", std::to_string(mib), " MiB on ", tt.pageKind());
 			}
+		} catch (const std::bad_alloc &) {
+			tt.resize(1);
+			printSafe("info string setoption Hash: can't allocate ", value, " MiB, using 1 MiB");
 		} catch (...) {
 			if (isDebugMode) {
 				printSafe("info string setoption Hash: invalid value '", value, "'");
 			}
 		}
 	}
+	else if (lname == "pext") {
+		std::string lvalue = value;
+		for (char& c : lvalue) {
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+		if (lvalue != "true" && lvalue != "false") {
+			if (isDebugMode) {
+				printSafe("info string setoption PEXT: expected 'true' or 'false'");
+			}
+			return;
+		}
+
+		setSliderBackend(lvalue == "true" ? SLIDER_PEXT : SLIDER_MAGIC);
+		if (isDebugMode) {
+			printSafe("info string slider attacks use ",
+			          sliderBackend == SLIDER_PEXT ? "PEXT" : "magic", " indexing");
+		}
+	}
 	else if (lname == "clear hash") {
 		tt.clear();
 		if (isDebugMode) {
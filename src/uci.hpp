@@ -17,6 +17,7 @@ class UciEngine {
 
    private:
 	void preUciInit(void);
+	void setPosition(const Position& newPos);  // starts a new game history at newPos
 
 	void handleUciCmd(void);
 	void handleDebugCmd(void);
@@ -26,6 +27,11 @@ class UciEngine {
 	void handleGoCmd(void);
 	void handleStopCmd(void);
 	void handleSetoptionCmd(void);
+	void handleSaveHashCmd(void);
+	void handleLoadHashCmd(void);
+	void handleTtCmd(void);
+
+	std::string restOfLine(size_t from) const;  // tokens from 'from' on, joined by spaces
 
 	// token buffers
 	std::vector<std::string> tokens;
@@ -36,6 +42,7 @@ class UciEngine {
 
 	// engine state
 	TranspositionTable tt;
+	PositionHistory history;  // played game & undo stacks of pos
 	Position pos;
 	MoveGenerator gen = MoveGenerator(&pos);  // move generator bound to pos (for verifying moves)
 	bool isDebugMode = false;
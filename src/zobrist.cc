@@ -1,33 +1,34 @@
 #include "zobrist.hpp"
 
-uint64_t Z_PSQ[12][64];
-uint64_t Z_CASTLING[16];
-uint64_t Z_EP_FILE[8];
-uint64_t Z_BLACK_TO_MOVE;
+#include <cstddef>
 
-static uint64_t splitmix64(uint64_t &x) {
-	uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+// n-th output of the splitmix64 stream, so every table can be generated on its own at compile time
+static constexpr uint64_t splitmix64(uint64_t seed, uint64_t n) {
+	uint64_t z = seed + (n + 1) * 0x9E3779B97F4A7C15ULL;
 	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
 	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
 	return z ^ (z >> 31);
 }
 
-void initZobristTables(uint64_t seed) {
-	uint64_t s = seed;
-
-	for (int p = 0; p < 12; p++) {
-		for (int sq = 0; sq < 64; sq++) {
-			Z_PSQ[p][sq] = splitmix64(s);
-		}
-	}
-
-	for (int i = 0; i < 16; i++) {
-		Z_CASTLING[i] = splitmix64(s);
+template <size_t N>
+static constexpr std::array<uint64_t, N> makeKeys(uint64_t firstKey) {
+	std::array<uint64_t, N> keys{};
+	for (size_t i = 0; i < N; i++) {
+		keys[i] = splitmix64(ZOBRIST_SEED, firstKey + i);
 	}
+	return keys;
+}
 
-	for (int i = 0; i < 8; i++) {
-		Z_EP_FILE[i] = splitmix64(s);
+static constexpr std::array<std::array<uint64_t, 64>, 12> makePsqKeys(void) {
+	std::array<std::array<uint64_t, 64>, 12> keys{};
+	for (size_t p = 0; p < 12; p++) {
+		keys[p] = makeKeys<64>(p * 64);
 	}
-
-	Z_BLACK_TO_MOVE = splitmix64(s);
+	return keys;
 }
+
+// keys are drawn in the order pieces, castling, ep file, side to move
+constexpr std::array<std::array<uint64_t, 64>, 12> Z_PSQ = makePsqKeys();
+constexpr std::array<uint64_t, 16> Z_CASTLING = makeKeys<16>(12 * 64);
+constexpr std::array<uint64_t, 8> Z_EP_FILE = makeKeys<8>(12 * 64 + 16);
+constexpr uint64_t Z_BLACK_TO_MOVE = splitmix64(ZOBRIST_SEED, 12 * 64 + 16 + 8);
@@ -1,13 +1,15 @@
 #ifndef ZOBRIST_HPP
 #define ZOBRIST_HPP
 
+#include <array>
 #include <cstdint>
 
-extern uint64_t Z_PSQ[12][64];
-extern uint64_t Z_CASTLING[16];
-extern uint64_t Z_EP_FILE[8];
-extern uint64_t Z_BLACK_TO_MOVE;
+// seed of the splitmix64 stream the keys are drawn from
+constexpr uint64_t ZOBRIST_SEED = 0x9E3779B97F4A7C15ULL;
 
-void initZobristTables(uint64_t seed = 0x9E3779B97F4A7C15ULL);
+extern const std::array<std::array<uint64_t, 64>, 12> Z_PSQ;
+extern const std::array<uint64_t, 16> Z_CASTLING;
+extern const std::array<uint64_t, 8> Z_EP_FILE;
+extern const uint64_t Z_BLACK_TO_MOVE;
 
 #endif  // ZOBRIST_HPP
@@ -0,0 +1,82 @@
+import argparse
+import os
+import subprocess
+import sys
+from pathlib import Path
+
+REPO = Path(__file__).resolve().parents[2]
+WORK = REPO / "build" / "perft"
+TARGET = "Knightrider"
+
+# (position command arguments, depth, expected node count)
+CASES = [
+    ("startpos", 5, 4865609),
+    ("fen r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603),
+    ("fen 8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624),
+    ("fen r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333),
+    ("fen r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333),
+    ("fen rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487),
+    ("fen r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P3/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3065277),
+    ("fen 3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888),
+    ("fen 8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133),
+    ("fen 8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467),
+    ("fen 8/5bk1/8/2Pp4/8/1K6/8/8 w - d6 0 1", 6, 824064),
+    ("fen 8/8/1k6/8/2pP4/8/5BK1/8 b - d3 0 1", 6, 824064),
+    ("fen 5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072),
+    ("fen 3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711),
+    ("fen r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206),
+    ("fen r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476),
+    ("fen 2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001),
+    ("fen 8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658),
+    ("fen 4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342),
+    ("fen 8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683),
+    ("fen K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217),
+    ("fen 8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584),
+    ("fen 8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527),
+]
+
+def parse_args(argv):
+    p = argparse.ArgumentParser(prog="run.py perft", description="perft node counts of the move generator")
+    p.add_argument("--binary", default=None, help="engine to test (default: build the working tree)")
+    p.add_argument("--build-type", default="Debug",
+                   help="CMake build type, Debug also checks the generator's asserts (e.g. givesCheck)")
+    p.add_argument("--jobs", type=int, default=os.cpu_count())
+    return p.parse_args(argv)
+
+
+def build(build_type, jobs):
+    bdir = WORK / f"build-{build_type.lower()}"
+    subprocess.run(["cmake", "-S", str(REPO), "-B", str(bdir), f"-DCMAKE_BUILD_TYPE={build_type}"], check=True)
+    subprocess.run(["cmake", "--build", str(bdir), "-j", str(jobs)], check=True)
+    return bdir / TARGET
+
+
+def perft(binary, pos, depth):
+    commands = f"position {pos}\ngo perft {depth}\nquit\n"
+    proc = subprocess.run([str(binary)], input=commands, capture_output=True, text=True)
+    if proc.returncode != 0:
+        print(proc.stderr, end="", file=sys.stderr)
+        return None
+    for line in proc.stdout.splitlines():
+        if line.startswith("Nodes searched:"):
+            return int(line.split()[2])
+    return None
+
+
+def main(argv):
+    args = parse_args(argv)
+    binary = Path(args.binary).resolve() if args.binary else build(args.build_type, args.jobs)
+
+    failed = 0
+    for pos, depth, expected in CASES:
+        nodes = perft(binary, pos, depth)
+        status = "ok" if nodes == expected else "FAIL"
+        failed += nodes != expected
+        print(f"{status:4} depth {depth} {pos}: {nodes} (expected {expected})")
+
+    print(f"{len(CASES) - failed}/{len(CASES)} positions passed")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
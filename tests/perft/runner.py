@@ -0,0 +1,4 @@
+from .perft import main
+
+def run(args=None):
+    return main(args or [])
@@ -3,9 +3,11 @@
 import argparse
 import sys
 
+from perft.runner import run as run_perft
 from strength.runner import run as run_strength
+from tt.runner import run as run_tt
 
-RUNNERS = {"strength": run_strength}
+RUNNERS = {"perft": run_perft, "strength": run_strength, "tt": run_tt}
 
 def main():
     parser = argparse.ArgumentParser(description="Knightrider test orchestrator")
@@ -0,0 +1,4 @@
+from .tt import main
+
+def run(args=None):
+    return main(args or [])
@@ -0,0 +1,131 @@
+// transposition table stress test: threads probe & store a shared pool of keys and check every hit
+// against the full key it was probed with, once on the lock-free table & once behind striped locks
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "tt.hpp"
+
+std::mutex printMutex;
+
+// at most one key per 16 bit tag, so a hit can only be the entry of the key that was probed
+static constexpr uint64_t POOL_SIZE = 1 << 16;
+static constexpr int LOCK_COUNT = 64;
+
+static uint64_t mix(uint64_t z) {
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// the low 16 bits are the index into the pool, everything stored is derived from the rest
+static uint64_t poolKey(uint64_t idx) { return (mix(idx + 1) & ~0xFFFFULL) | idx; }
+static int depthOf(uint64_t key) { return static_cast<int>((key >> 16) % 100); }
+static Score valueOf(uint64_t key) { return static_cast<Score>((key >> 24) % 20000) - 10000; }
+static TTFlag flagOf(uint64_t key) { return static_cast<TTFlag>((key >> 56) % 3); }
+static Move moveOf(uint64_t key) {
+	return Move(1ULL << ((key >> 40) & 63), 1ULL << ((key >> 46) & 63), PT_NULL, false, false);
+}
+
+// the table as the search uses it, shared without locks
+struct LockFreeTable {
+	TranspositionTable tt;
+
+	bool probe(uint64_t key, TTEntry &out) { return tt.probe(key, out); }
+	void store(uint64_t key) { tt.store(key, depthOf(key), valueOf(key), flagOf(key), moveOf(key)); }
+};
+
+// baseline: the same table behind locks picked by the high key bits, which also pick the bucket,
+// so one bucket is always guarded by the same lock as long as the bucket count is a power of two
+struct StripedTable {
+	TranspositionTable tt;
+	std::mutex locks[LOCK_COUNT];
+
+	bool probe(uint64_t key, TTEntry &out) {
+		std::lock_guard<std::mutex> guard(locks[key >> 58]);
+		return tt.probe(key, out);
+	}
+	void store(uint64_t key) {
+		std::lock_guard<std::mutex> guard(locks[key >> 58]);
+		tt.store(key, depthOf(key), valueOf(key), flagOf(key), moveOf(key));
+	}
+};
+
+struct Result {
+	double nsPerOp;
+	uint64_t hits;
+	uint64_t torn;  // hits whose data does not belong to the probed key
+};
+
+template <typename Table>
+static Result run(int threadCount, uint64_t opsPerThread, size_t mb) {
+	Table *table = new Table;
+	table->tt.resize(mb);
+
+	std::atomic<uint64_t> hits{0}, torn{0};
+	std::vector<std::thread> threads;
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int id = 0; id < threadCount; id++) {
+		threads.emplace_back([&, id] {
+			uint64_t threadHits = 0, threadTorn = 0;
+			for (uint64_t i = 0; i < opsPerThread; i++) {
+				const uint64_t key = poolKey(mix(static_cast<uint64_t>(id) << 40 | i) % POOL_SIZE);
+
+				TTEntry entry;
+				if (table->probe(key, entry)) {
+					threadHits++;
+					if (entry.depth != depthOf(key) || entry.value != valueOf(key) ||
+					    entry.flag != flagOf(key) || !(entry.bestMove == moveOf(key))) {
+						threadTorn++;
+					}
+				}
+				table->store(key);
+			}
+			hits += threadHits;
+			torn += threadTorn;
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	const double seconds =
+	    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	delete table;
+	return {seconds * 1e9 / static_cast<double>(opsPerThread * threadCount), hits, torn};
+}
+
+int main(int argc, char **argv) {
+	const bool striped = argc > 1 && std::strcmp(argv[1], "striped") == 0;
+	if (argc < 2 || (!striped && std::strcmp(argv[1], "lockfree") != 0)) {
+		std::fprintf(stderr, "usage: %s lockfree|striped [threads] [ops per thread] [hash MiB]\n",
+		             argv[0]);
+		return 2;
+	}
+
+	const int threadCount = argc > 2 ? std::atoi(argv[2]) : 4;
+	const uint64_t opsPerThread = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 2'000'000;
+	const size_t mb = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+
+	Result result;
+	try {
+		result = striped ? run<StripedTable>(threadCount, opsPerThread, mb)
+		                 : run<LockFreeTable>(threadCount, opsPerThread, mb);
+	}
+	catch (const std::bad_alloc &) {
+		std::fprintf(stderr, "could not allocate %zu MiB\n", mb);
+		return 2;
+	}
+
+	std::printf("%s threads %d: %.1f ns/op, hits %llu, torn %llu\n", argv[1], threadCount,
+	            result.nsPerOp, static_cast<unsigned long long>(result.hits),
+	            static_cast<unsigned long long>(result.torn));
+	return result.torn == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+import argparse
+import os
+import subprocess
+import sys
+from pathlib import Path
+
+REPO = Path(__file__).resolve().parents[2]
+WORK = REPO / "build" / "tt"
+TARGET = "Knightrider-ttstress"
+TSAN_TARGET = "Knightrider-ttstress-tsan"
+TABLES = ("lockfree", "striped")
+
+def parse_args(argv):
+    p = argparse.ArgumentParser(prog="run.py tt",
+                                description="TT stress test under ThreadSanitizer & lock-free vs striped timings")
+    p.add_argument("--threads", type=int, default=4)
+    p.add_argument("--ops", type=int, default=5_000_000, help="operations per thread of the timed runs")
+    p.add_argument("--tsan-ops", type=int, default=200_000, help="operations per thread under ThreadSanitizer")
+    p.add_argument("--hash", type=int, default=1, help="table size in MiB, a power of two")
+    p.add_argument("--jobs", type=int, default=os.cpu_count())
+    return p.parse_args(argv)
+
+
+def build(jobs):
+    subprocess.run(["cmake", "-S", str(REPO), "-B", str(WORK), "-DCMAKE_BUILD_TYPE=Release"], check=True)
+    subprocess.run(["cmake", "--build", str(WORK), "-j", str(jobs), "--target", TARGET, TSAN_TARGET],
+                   check=True)
+
+
+def stress(target, table, threads, ops, mb):
+    env = dict(os.environ, TSAN_OPTIONS="halt_on_error=1")
+    proc = subprocess.run([str(WORK / target), table, str(threads), str(ops), str(mb)],
+                          capture_output=True, text=True, env=env)
+    print(f"{'ok' if proc.returncode == 0 else 'FAIL':4} {target} {proc.stdout.strip()}")
+    if proc.returncode != 0:
+        print(proc.stderr, end="", file=sys.stderr)
+    return proc.returncode == 0
+
+
+def main(argv):
+    args = parse_args(argv)
+    build(args.jobs)
+
+    # every hit is checked against its key, ThreadSanitizer reports any unsynchronized access
+    passed = all([stress(TSAN_TARGET, table, args.threads, args.tsan_ops, args.hash) for table in TABLES])
+
+    # the lock-striped table is the baseline the lock-free one has to beat
+    for threads in sorted({1, args.threads}):
+        for table in TABLES:
+            passed &= stress(TARGET, table, threads, args.ops, args.hash)
+
+    return 0 if passed else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))